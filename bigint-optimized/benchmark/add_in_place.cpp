@@ -0,0 +1,69 @@
+//
+// Steady-state cost of big_integer::operator+= on a long-lived accumulator:
+// every global allocation is counted, after the warm up there should be none
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "big_integer.h"
+
+namespace
+{
+    size_t allocations = 0;
+}
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char** argv) {
+    size_t digits = (argc > 1 ? std::atoi(argv[1]) : 100);
+    size_t iterations = (argc > 2 ? std::atoi(argv[2]) : 1000000);
+
+    std::vector <big_integer> summands;
+    for (size_t i = 0; i < 8; i++) {
+        big_integer x = std::rand();
+        while (x.length() < digits) {
+            x *= RAND_MAX;
+            x += std::rand();
+        }
+        summands.push_back(x);
+        summands.push_back(-x);
+    }
+
+    //the summands cancel in pairs, so the accumulator keeps its length
+    big_integer sum = summands[0];
+    sum *= 4;
+    for (size_t i = 0; i < summands.size(); i++) {
+        sum += summands[i];
+    }
+
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        sum += summands[i % summands.size()];
+    }
+    double seconds = std::chrono::duration <double> (std::chrono::steady_clock::now() - start).count();
+    size_t count = allocations - before;
+
+    std::cout << digits << " digits, " << iterations << " additions: "
+              << seconds * 1e9 / iterations << " ns per +=, "
+              << double(count) / iterations << " allocations per +=" << std::endl;
+    return count == 0 ? 0 : 1;
+}
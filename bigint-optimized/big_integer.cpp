@@ -3,16 +3,39 @@
 //
 
 #include "big_integer.h"
+#include "mpn.h"
 #include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
 
-const unsigned int DIGIT_MAX = UINT32_MAX;
-const int BASE = 32;
-const int DEC_BASE = 1e9;
+typedef big_integer::digit_t digit_t;
+typedef big_integer::double_digit_t double_digit_t;
+
+const digit_t DIGIT_MAX = std::numeric_limits <digit_t>::max();
+const int BASE = std::numeric_limits <digit_t>::digits;
 
 using std::string;
 
-typedef unsigned int digit_t;
-typedef unsigned long long double_digit_t;
+//scratch space comes from the current digit_allocator as well
+typedef std::vector <digit_t, allocator_adaptor <digit_t>> scratch_vector;
+
+big_integer::algorithm_thresholds big_integer::thresholds = {
+        32, //karatsuba_mul
+        250, //toom3_mul
+        600, //toom4_mul
+        2000, //ntt_mul
+        32, //karatsuba_sqr
+        250, //toom3_sqr
+        600, //toom4_sqr
+        2000, //ntt_sqr
+        60, //burnikel_ziegler_div
+        30, //dc_to_string
+        30, //dc_from_string
+        512, //barrett_mul
+        400 //half_gcd
+};
 
 //cast
 digit_t digit_cast(int x) {
@@ -27,57 +50,21 @@ digit_t digit_cast(double_digit_t x) {
     return static_cast <digit_t> (x & DIGIT_MAX);
 }
 
-void swap(big_integer& a, big_integer& b) {
-    std::swap(a.sign, b.sign);
-    std::swap(a.digits, b.digits);
+void swap(big_integer& a, big_integer& b) noexcept {
+    swap(a.digits, b.digits);
 }
 
-string to_string(big_integer const& b) {
-    string str;
-    if (b.is_zero()) {
-        return "0";
-    }
-
-    if (b.is_neg_one()) {
-        return "-1";
-    }
-    big_integer x = b.abs();
-    while (!x.is_zero()) {
-        digit_t cur = (x % DEC_BASE).get_digit(0);
-
-        for (size_t i = 0; i < 9; i++) {
-            str.push_back(char('0' + (cur % 10)));
-            cur /= 10;
-        }
-        x /= DEC_BASE;
-    }
-    while (!str.empty() && str.back() == '0') {
-        str.pop_back();
-    }
-    if (b.sign) {
-        str.push_back('-');
-    }
-    std::reverse(str.begin(), str.end());
-    return str;
-}
-
-void div_long_short(digit_vector const &a, const digit_t b, digit_vector &res) {
-    double_digit_t c, carry = 0;
-    res.resize(a.size());
-    for (size_t i = a.size(); i-- > 0;) {
-        c = (carry << 32) + a[i];
-        res[i] = digit_cast(c / b);
-        carry = c % b;
-    }
+digit_t div_long_short(digit_vector const &a, const digit_t b, digit_vector &res) {
+    size_t n = a.size();
+    res.resize(n);
+    digit_t* r = res.mutable_data();
+    return mpn::divrem_1(r, a.data(), n, b);
 }
 
 void mod_long_short(digit_vector const& a, const digit_t b, digit_vector& res) {
+    digit_t rem = mpn::mod_1(a.data(), a.size(), b);
     res.resize(1);
-    double_digit_t carry = 0;
-    for (size_t i = a.size(); i-- > 0;) {
-        carry = (carry * (double_digit_cast(1) + DIGIT_MAX) + a[i]) % b;
-    }
-    res[0] = carry;
+    res.mutable_data()[0] = rem;
 }
 
 size_t big_integer::length() const {
@@ -85,117 +72,135 @@ size_t big_integer::length() const {
 }
 
 bool big_integer::is_zero_digit(digit_t d) const {
-    return (sign && d == DIGIT_MAX) || (!sign && d == 0);
+    return (sign() && d == DIGIT_MAX) || (!sign() && d == 0);
 }
 
 bool big_integer::is_neg_one() const {
-    return sign && length() == 0;
+    return sign() && length() == 0;
 }
 
 void big_integer::trim() {
-    while (length() > 0 && is_zero_digit(digits.back())) {
-        digits.pop_back();
+    digit_t const* d = digits.data();
+    size_t n = length();
+    while (n > 0 && is_zero_digit(d[n - 1])) {
+        n--;
+    }
+    if (n < length()) {
+        digits.resize(n);
     }
 }
 
 digit_t big_integer::get_digit(size_t pos) const {
     if (pos >= digits.size()) {
-        return (sign ? DIGIT_MAX : 0);
+        return (sign() ? DIGIT_MAX : 0);
     }
     return digits[pos];
 }
 
 big_integer big_integer::abs() const {
-    if (!sign) {
+    if (!sign()) {
         return *this;
     }
     return -(*this);
 }
 
 void big_integer::normalize() {
-    if (!sign) {
+    if (!sign()) {
         return;
     }
     double_digit_t c = 0, carry = 1;
-    digits.resize(digits.size() + 1);
-    for (size_t i = 0; i < length(); i++) {
-        c = carry + (~get_digit(i));
-        digits[i] = digit_cast(c);
+    size_t n = digits.size() + 1;
+    digits.resize(n);
+    digit_t* r = digits.mutable_data();
+    for (size_t i = 0; i < n; i++) {
+        c = carry + (~r[i]);
+        r[i] = digit_cast(c);
         carry = c >> BASE;
     }
     trim();
 }
 
 bool big_integer::is_zero() const {
-    return (!sign) && length() == 0;
+    return (!sign()) && length() == 0;
+}
+
+size_t big_integer::bit_length() const {
+    if (sign()) {
+        return abs().bit_length();
+    }
+    size_t n = length();
+    if (n == 0) {
+        return 0;
+    }
+    size_t bits = (n - 1) * BASE;
+    for (digit_t top = digits[n - 1]; top != 0; top >>= 1) {
+        bits++;
+    }
+    return bits;
+}
+
+digit_t big_integer::mod_digit(digit_t d) const {
+    if (d == 0) {
+        throw std::runtime_error("Division by zero");
+    }
+    if (sign()) {
+        return abs().mod_digit(d);
+    }
+    digit_vector rem;
+    mod_long_short(digits, d, rem);
+    return rem[0];
 }
 
 //constructors
 
-big_integer::big_integer() : sign(false) {}
+big_integer::big_integer() {}
 
 
 big_integer::big_integer(big_integer const& other)
-        : sign(other.sign)
-        , digits(other.digits)
-{
-    trim();
-}
+        : digits(other.digits)
+{}
+
+//the moved-from value is 0
+big_integer::big_integer(big_integer&& other) noexcept
+        : digits(std::move(other.digits))
+{}
 
 big_integer::big_integer(const int x)
-        : sign(x < 0),
-          digits(1)
+        : digits(1)
            {
-    digits[0] = digit_cast(x);
+    set_sign(x < 0);
+    digits.mutable_data()[0] = digit_cast(x);
     trim();
 }
 
 big_integer::big_integer(bool s, digit_vector const& d)
-        : sign(s),
-          digits(d) {
+        : digits(d) {
+    set_sign(s);
     trim();
 };
 
+big_integer::big_integer(bool s, digit_vector&& d)
+        : digits(std::move(d)) {
+    set_sign(s);
+    trim();
+};
 
-big_integer to_number(string const& str) {
-    big_integer new_num = 0;
-    bool new_sign = (str[0] == '-');
-    digit_t acc = 0;
-    digit_t b = 1;
-    for (size_t i = new_sign; i < str.size(); i++) {
-        if (str[i] < '0' || str[i] > '9') {
-            throw std::runtime_error("Digit expected");
-        }
-        acc = acc * 10 + (str[i] - '0');
-        b *= 10;
-        if (acc > ((DIGIT_MAX - 9) / 10) || b > DIGIT_MAX / 10) {
-            new_num *= b;
-            if (new_sign) {
-                new_num -= acc;
-            }
-            else {
-                new_num += acc;
-            }
-            b = 1, acc = 0;
-        }
-    }
-    if (acc || b > 1) {
-        new_num *= b;
-        if (new_sign) {
-            new_num -= acc;
-        }
-        else {
-            new_num += acc;
-        }
-    }
-    return new_num;
-}
 
-big_integer::big_integer(string const& str) : big_integer(to_number(str)) {}
+big_integer to_number(char const* str, size_t len, unsigned int base);
+
+big_integer::big_integer(string const& str, unsigned int base) : big_integer(to_number(str.data(), str.size(), base)) {}
+
+big_integer::big_integer(char const* first, char const* last, unsigned int base)
+        : big_integer(to_number(first, last - first, base)) {}
 
 //operators
 
-big_integer& big_integer::operator=(big_integer other) {
+big_integer& big_integer::operator=(big_integer const& other) {
+    digits = other.digits;
+    return *this;
+}
+
+big_integer& big_integer::operator=(big_integer&& other) noexcept {
     swap(*this, other);
     return *this;
 }
@@ -203,16 +208,16 @@ big_integer& big_integer::operator=(big_integer other) {
 //equality
 
 bool operator==(big_integer const &a, big_integer const &b) {
-    return (a.sign == b.sign && a.digits == b.digits);
+    return (a.sign() == b.sign() && a.digits == b.digits);
 }
 
 bool operator!=(big_integer const &a, big_integer const &b) {
-    return (a.sign != b.sign || a.digits != b.digits);
+    return (a.sign() != b.sign() || a.digits != b.digits);
 }
 
 bool operator<(big_integer const &a, big_integer const &b) {
-    if (a.sign != b.sign) {
-        return a.sign;
+    if (a.sign() != b.sign()) {
+        return a.sign();
     }
     if (!a.is_neg_one() && b.is_neg_one()) {
         return true;
@@ -242,117 +247,104 @@ bool operator>=(big_integer const &a, big_integer const &b) {
 
 //arithmetic binary
 
+//the copy of a detaches once to the length of the sum
 big_integer operator+(big_integer const& a, big_integer const& b) {
-    size_t n = std::max(a.length(), b.length()) + 1;
-    digit_vector res(n);
-    double_digit_t carry = 0;
-    double_digit_t c;
-    for (size_t i = 0; i < n; i++) {
-        c = carry + a.get_digit(i) + b.get_digit(i);
-        res[i] = digit_cast(c);
-        carry = c >> BASE;
-    }
-    bool res_sign = (res.back() & (1 << (BASE - 1)));
-    return big_integer(res_sign, res);
+    big_integer res(a);
+    res.add_in_place(b, false);
+    return res;
 }
 
 big_integer operator-(big_integer const& a, big_integer const& b) {
-    size_t n = std::max(a.length(), b.length()) + 1;
-    digit_vector res(n);
-    double_digit_t carry = 1;
-    double_digit_t c;
-    for (size_t i = 0; i < n; i++) {
-        c = carry + a.get_digit(i) + (~b.get_digit(i));
-        res[i] = digit_cast(c);
-        carry = c >> BASE;
-    }
-    bool res_sign = (res.back() & (1 << (BASE - 1)));
-    return big_integer(res_sign, res);
+    big_integer res(a);
+    res.add_in_place(b, true);
+    return res;
 }
 
-void long_mul(digit_vector const& a, digit_vector const& b, digit_vector& res) {
-    res.resize(a.size() + b.size() + 1, 0);
-    double_digit_t carry = 0, c = 0;
-    double_digit_t mul;
-    for (size_t i = 0; i < a.size(); i++) {
-        carry = 0;
-        for (size_t j = 0; j < b.size(); j++) {
-            mul = double_digit_cast(a[i]) * b[j];
-            c = carry + res[i + j] + digit_cast(mul);
-            res[i + j] = digit_cast(c);
-            carry = (c >> BASE) + (mul >> BASE);
-        }
-        res[i + b.size()] += digit_cast(carry);
-    }
+//the overloads taking an rvalue add in place into its digits
+
+big_integer operator+(big_integer&& a, big_integer const& b) {
+    a += b;
+    return std::move(a);
 }
 
-bool smaller(digit_vector const& a, digit_vector const& b, const size_t shift) {
-    for (size_t i = b.size(); i-- > 0;) {
-        if (a[i + shift] != b[i]) {
-            return (a[i + shift] < b[i]);
-        }
-    }
-    return false;
+big_integer operator+(big_integer const& a, big_integer&& b) {
+    b += a;
+    return std::move(b);
 }
 
-void vector_dif(digit_vector &a, digit_vector const &b, const size_t shift) {
-    double_digit_t carry = 1;
-    double_digit_t c;
-    for (size_t i = 0; i < b.size(); i++) {
-        c = carry + a[i + shift] + (~b[i]);
-        a[i + shift] = digit_cast(c);
-        carry = c >> BASE;
-    }
+big_integer operator+(big_integer&& a, big_integer&& b) {
+    a += b;
+    return std::move(a);
 }
-void mul_long_short(digit_vector const &a, const digit_t b, digit_vector &res) {
-    double_digit_t c;
-    double_digit_t carry = 0;
-    double_digit_t mul;
-    res.resize(a.size() + 1);
-    for (size_t i = 0; i < a.size(); i++) {
-        mul = double_digit_cast(a[i]) * b;
-        c = mul + carry;
-        res[i] = digit_cast(c);
-        carry = (c >> BASE);
+
+big_integer operator-(big_integer&& a, big_integer const& b) {
+    a -= b;
+    return std::move(a);
+}
+
+big_integer operator-(big_integer const& a, big_integer&& b) {
+    if (&a != &b) {
+        b.negate();
     }
-    res[a.size()] = digit_cast(carry);
+    b.add_in_place(a, &a == &b);
+    return std::move(b);
 }
 
-digit_t trial(const digit_t a, const digit_t b, const digit_t div) {
-    return digit_cast(std::min(double_digit_cast(1) + DIGIT_MAX, (((double_digit_t(a)) << BASE) + b) / div));
+big_integer operator-(big_integer&& a, big_integer&& b) {
+    a -= b;
+    return std::move(a);
 }
 
-void long_div(digit_vector const& a, digit_vector const& b, digit_vector& res) {
-    digit_t scale_factor = digit_cast((double_digit_cast(1) + DIGIT_MAX) / (double_digit_cast(1) + b.back()));
-    digit_vector q;
-    digit_vector d;
-    digit_vector dt;
-    mul_long_short(a, scale_factor, q);
-    mul_long_short(b, scale_factor, d);
-    while (!d.empty() && d.back() == 0) {
-        d.pop_back();
+void long_sqr(digit_vector const& a, digit_vector& res) {
+    size_t n = a.size();
+    res.resize(2 * n + 1);
+    digit_t* r = res.mutable_data();
+    r[2 * n] = 0;
+    scratch_vector scratch(mpn::sqr_itch(n));
+    mpn::sqr(r, a.data(), n, scratch.data());
+}
+
+void long_mul(digit_vector const& a, digit_vector const& b, digit_vector& res) {
+    size_t n = std::max(a.size(), b.size());
+    size_t m = std::min(a.size(), b.size());
+    res.resize(n + m + 1);
+    digit_t* r = res.mutable_data();
+    r[n + m] = 0;
+    scratch_vector scratch(mpn::mul_itch(n, m));
+    if (a.size() >= b.size()) {
+        mpn::mul(r, a.data(), n, b.data(), m, scratch.data());
     }
-    while (!q.empty() && q.back() == 0) {
-        q.pop_back();
+    else {
+        mpn::mul(r, b.data(), n, a.data(), m, scratch.data());
     }
-    digit_t div = d.back();
+}
+
+void mul_long_short(digit_vector const &a, const digit_t b, digit_vector &res) {
+    size_t n = a.size();
+    res.resize(n + 1);
+    digit_t* r = res.mutable_data();
+    r[n] = mpn::mul_1(r, a.data(), n, b);
+}
+
+//q[0, n - m + 2) = a / b, r[0, m + 1) = a % b for n >= m >= 2, each with a zero digit on top
+void long_divrem(digit_vector const& a, digit_vector const& b, digit_vector& q, digit_vector& r) {
     size_t n = a.size();
     size_t m = b.size();
-    res.resize(n - m + 2);
-    q.push_back(0);
-    for (size_t i = n - m + 1; i-- > 0;) {
-        digit_t qt = trial(q[i + m], q[i + m - 1], div);
-        mul_long_short(d, qt, dt);
-        while (smaller(q, dt, i)) {
-            qt--;
-            mul_long_short(d, qt, dt);
-        }
-        res[i] = qt;
-        vector_dif(q, dt, i);
-    }
+    q.resize(n - m + 2);
+    r.resize(m + 1);
+    digit_t* qt = q.mutable_data();
+    digit_t* rt = r.mutable_data();
+    qt[n - m + 1] = 0;
+    rt[m] = 0;
+    scratch_vector scratch(mpn::divrem_itch(n, m));
+    mpn::divrem(qt, rt, a.data(), n, b.data(), m, scratch.data());
 }
 
 big_integer operator*(big_integer const& a, big_integer const& b) {
+    //a shared buffer may be shrunk by one of its owners only, so the lengths must agree as well
+    if (&a == &b || (a.sign() == b.sign() && a.length() == b.length() && a.digits.data() == b.digits.data())) {
+        return a.square();
+    }
     if (a.is_zero() || b.is_zero()) {
         return 0;
     }
@@ -368,57 +360,227 @@ big_integer operator*(big_integer const& a, big_integer const& b) {
     else {
         long_mul(x.digits, y.digits, res);
     }
-    big_integer mul(a.sign ^ b.sign, res);
+    big_integer mul(a.sign() ^ b.sign(), res);
     mul.normalize();
     return mul;
 }
 
-big_integer operator/(big_integer const& a, big_integer const& b) {
+//r[0, rn) += a or r[0, rn) -= a modulo B^rn, a is sign extended to rn digits
+void add_signed(digit_t* r, size_t rn, big_integer const& a, bool subtract) {
+    digit_t mask = (subtract ? DIGIT_MAX : 0);
+    double_digit_t carry = subtract;
+    double_digit_t c;
+    for (size_t i = 0; i < rn; i++) {
+        c = carry + r[i] + (a.get_digit(i) ^ mask);
+        r[i] = digit_cast(c);
+        carry = c >> BASE;
+    }
+}
+
+//the sum is kept in two's complement modulo B^len, where len leaves two digits above the longest product
+//for the carries of up to B / 2 terms and the sign, so the products of magnitudes can be added and subtracted
+//without caring about overflow; short products go row by row straight into the sum, long ones through scratch
+big_integer big_integer::sum_of_products(product_term const* terms, size_t count) {
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        len = std::max(len, terms[i].a->length() + (terms[i].b ? terms[i].b->length() : 0));
+    }
+    len += 2;
+    digit_vector res(len);
+    digit_t* r = res.mutable_data();
+    scratch_vector scratch;
+
+    for (size_t i = 0; i < count; i++) {
+        product_term const& t = terms[i];
+        if (!t.b) {
+            add_signed(r, len, *t.a, t.subtract);
+            continue;
+        }
+        if (t.a->is_zero() || t.b->is_zero()) {
+            continue;
+        }
+        bool subtract = t.subtract ^ t.a->sign() ^ t.b->sign();
+        big_integer x(t.a->abs());
+        big_integer y(t.b->abs());
+        if (x.length() < y.length()) {
+            swap(x, y);
+        }
+        size_t n = x.length();
+        size_t m = y.length();
+        digit_t const* xd = x.digits.data();
+        digit_t const* yd = y.digits.data();
+        if (m < thresholds.karatsuba_mul) {
+            for (size_t j = 0; j < m; j++) {
+                digit_t c = (subtract ? mpn::submul_1(r + j, xd, n, yd[j]) : mpn::addmul_1(r + j, xd, n, yd[j]));
+                if (subtract) {
+                    mpn::sub_from(r + j + n, len - j - n, &c, 1);
+                }
+                else {
+                    mpn::add_to(r + j + n, len - j - n, &c, 1);
+                }
+            }
+            continue;
+        }
+        bool sqr = (xd == yd && n == m);
+        scratch.resize(n + m + (sqr ? mpn::sqr_itch(n) : mpn::mul_itch(n, m)));
+        if (sqr) {
+            mpn::sqr(scratch.data(), xd, n, scratch.data() + 2 * n);
+        }
+        else {
+            mpn::mul(scratch.data(), xd, n, yd, m, scratch.data() + n + m);
+        }
+        if (subtract) {
+            mpn::sub_from(r, len, scratch.data(), n + m);
+        }
+        else {
+            mpn::add_to(r, len, scratch.data(), n + m);
+        }
+    }
+    return big_integer((r[len - 1] >> (BASE - 1)) != 0, std::move(res));
+}
+
+big_integer big_integer::square() const {
+    if (is_zero()) {
+        return 0;
+    }
+    big_integer x(abs());
+    digit_vector res;
+    if (x.length() == 1) {
+        mul_long_short(x.digits, x.get_digit(0), res);
+    }
+    else {
+        long_sqr(x.digits, res);
+    }
+    return big_integer(false, std::move(res));
+}
+
+void big_integer::divmod_to(big_integer& q, big_integer& r, big_integer const& a, big_integer const& b) {
     if (b.is_zero()) {
         throw std::runtime_error("Division by zero");
     }
 
     big_integer x = a.abs();
     big_integer y = b.abs();
+    bool q_sign = a.sign() ^ b.sign();
+    bool r_sign = a.sign();
 
     if (x < y) {
-        return 0;
+        r = a;
+        q = 0;
+        return;
     }
 
-    digit_vector res;
     if (y.length() == 1) {
-        div_long_short(x.digits, y.get_digit(0), res);
+        digit_t rem = div_long_short(x.digits, y.get_digit(0), q.digits);
+        q.digits.push_back(0);
+        r.digits.resize(1);
+        r.digits.mutable_data()[0] = rem;
     }
     else {
-        long_div(x.digits, y.digits, res);
+        long_divrem(x.digits, y.digits, q.digits, r.digits);
     }
-    big_integer qt = big_integer(a.sign ^ b.sign, res);
-    qt.normalize();
-    return qt;
+    q.set_sign(q_sign);
+    q.trim();
+    q.normalize();
+    r.set_sign(false);
+    r.trim();
+    if (r_sign && !r.is_zero()) {
+        r.set_sign(true);
+        r.normalize();
+    }
+}
+
+std::pair <big_integer, big_integer> big_integer::divmod(big_integer const& a, big_integer const& b) {
+    std::pair <big_integer, big_integer> res;
+    divmod_to(res.first, res.second, a, b);
+    return res;
+}
+
+big_integer operator/(big_integer const& a, big_integer const& b) {
+    return big_integer::divmod(a, b).first;
 }
 
 big_integer operator%(big_integer const &a, big_integer const &b) {
-    return a - (a / b) * b;
+    return big_integer::divmod(a, b).second;
+}
+
+//the in-place operators extend the digits by the sign digit to a length where the result fits
+//and write into them, a uniquely owned buffer of enough capacity is not reallocated
+
+//*this += b or *this -= b, b may be *this
+void big_integer::add_in_place(big_integer const& b, bool subtract) {
+    digit_t ext = (b.sign() ? DIGIT_MAX : 0);
+    size_t n = std::max(length(), b.length()) + 1;
+    digits.resize(n, sign() ? DIGIT_MAX : 0);
+    size_t m = b.length();
+    digit_t const* y = b.digits.data();
+    digit_t* r = digits.mutable_data();
+    digit_t mask = (subtract ? DIGIT_MAX : 0);
+    double_digit_t carry = (subtract ? 1 - mpn::sub_n(r, r, y, m) : mpn::add_n(r, r, y, m));
+    for (size_t i = m; i < n; i++) {
+        carry += double_digit_cast(r[i]) + (ext ^ mask);
+        r[i] = digit_cast(carry);
+        carry >>= BASE;
+    }
+    set_sign(r[n - 1] >> (BASE - 1));
+    trim();
+}
+
+//*this = -*this
+void big_integer::negate() {
+    size_t n = length() + 1;
+    digits.resize(n, sign() ? DIGIT_MAX : 0);
+    digit_t* r = digits.mutable_data();
+    double_digit_t carry = 1;
+    for (size_t i = 0; i < n; i++) {
+        carry += (~r[i]);
+        r[i] = digit_cast(carry);
+        carry >>= BASE;
+    }
+    set_sign(r[n - 1] >> (BASE - 1));
+    trim();
 }
 
 big_integer& big_integer::operator+=(big_integer const &b) {
-    return *this = *this + b;
+    add_in_place(b, false);
+    return *this;
 }
 
 big_integer& big_integer::operator-=(big_integer const &b) {
-    return *this = *this - b;
+    add_in_place(b, true);
+    return *this;
 }
 
+//in place when the absolute value of b fits a digit
 big_integer& big_integer::operator*=(big_integer const &b) {
-    return *this = *this * b;
+    bool negative = b.sign();
+    digit_t d = (negative ? 0 - b.get_digit(0) : b.get_digit(0));
+    //-B keeps a single zero digit, its absolute value does not fit one
+    if (b.length() > 1 || (negative && d == 0)) {
+        return *this = *this * b;
+    }
+    size_t n = length() + 2;
+    digits.resize(n, sign() ? DIGIT_MAX : 0);
+    digit_t* r = digits.mutable_data();
+    mpn::mul_1(r, r, n, d);
+    set_sign(r[n - 1] >> (BASE - 1));
+    trim();
+    if (negative) {
+        negate();
+    }
+    return *this;
 }
 
 big_integer& big_integer::operator/=(big_integer const &b) {
-    return *this = *this / b;
+    big_integer r;
+    divmod_to(*this, r, *this, b);
+    return *this;
 }
 
 big_integer& big_integer::operator%=(big_integer const &b) {
-    return *this = *this % b;
+    big_integer q;
+    divmod_to(q, *this, *this, b);
+    return *this;
 }
 
 // prefix/postfix
@@ -438,12 +600,13 @@ big_integer big_integer::operator-() const {
     double_digit_t carry = 1;
     double_digit_t c;
     digit_vector res(n);
+    digit_t* r = res.mutable_data();
     for (size_t i = 0; i < n; i++) {
         c = carry + (~get_digit(i));
-        res[i] = digit_cast(c);
+        r[i] = digit_cast(c);
         carry = c >> BASE;
     }
-    return big_integer(!sign, res);
+    return big_integer(!sign(), std::move(res));
 }
 
 big_integer big_integer::operator~() const {
@@ -451,7 +614,7 @@ big_integer big_integer::operator~() const {
     for (size_t i = 0; i < digits.size(); i++) {
         res.push_back(~digits[i]);
     }
-    return big_integer(!sign, res);
+    return big_integer(!sign(), std::move(res));
 }
 
 big_integer& big_integer::operator++() {
@@ -488,26 +651,26 @@ big_integer operator^(big_integer const& a, big_integer const& b) {
     return apply_bitwise(a, b, std::bit_xor <digit_t> ());
 }
 
-big_integer operator>>(big_integer const& a, digit_t shift) {
-    digit_vector res;
-    size_t mod = shift % BASE;
-    digit_t c;
-    for (size_t i = shift / BASE; i < a.length(); i++) {
-        c = (a.get_digit(i) >> mod) + ((a.get_digit(i + 1) << (BASE - mod)) & DIGIT_MAX);
-        res.push_back(c);
-    }
-    return big_integer(a.sign, res);
+big_integer operator>>(big_integer const& a, unsigned int shift) {
+    big_integer res(a);
+    res >>= shift;
+    return res;
 }
 
-big_integer operator<<(big_integer const& a, digit_t shift) {
-    digit_vector res(shift / BASE, 0);
-    size_t mod = shift % BASE;
-    digit_t c;
-    for (size_t i = 0; i < a.length(); i++) {
-        c = ((a.get_digit(i) << mod) & DIGIT_MAX) + (i > 0 ? (a.get_digit(i - 1) >> (BASE - mod)) : 0);
-        res.push_back(c);
-    }
-    return big_integer(a.sign, res);
+big_integer operator<<(big_integer const& a, unsigned int shift) {
+    big_integer res(a);
+    res <<= shift;
+    return res;
+}
+
+big_integer operator>>(big_integer&& a, unsigned int shift) {
+    a >>= shift;
+    return std::move(a);
+}
+
+big_integer operator<<(big_integer&& a, unsigned int shift) {
+    a <<= shift;
+    return std::move(a);
 }
 
 big_integer& big_integer::operator&=(big_integer const& b) {
@@ -522,11 +685,277 @@ big_integer& big_integer::operator^=(big_integer const& b) {
     return *this = *this ^ b;
 }
 
-big_integer& big_integer::operator>>=(digit_t shift) {
-    return *this = *this >> shift;
+//arithmetic shift, rounds towards minus infinity
+big_integer& big_integer::operator>>=(unsigned int shift) {
+    if (shift == 0) {
+        return *this;
+    }
+    size_t q = shift / BASE;
+    size_t n = length();
+    if (q >= n) {
+        digits.resize(0);
+        return *this;
+    }
+    digit_t* r = digits.mutable_data();
+    mpn::rshift(r, r + q, n - q, shift % BASE);
+    if (sign() && shift % BASE) {
+        r[n - q - 1] |= DIGIT_MAX << (BASE - shift % BASE);
+    }
+    digits.resize(n - q);
+    trim();
+    return *this;
+}
+
+big_integer& big_integer::operator<<=(unsigned int shift) {
+    if (shift == 0) {
+        return *this;
+    }
+    size_t q = shift / BASE;
+    size_t n = length();
+    digits.resize(n + q + 1, sign() ? DIGIT_MAX : 0);
+    digit_t* r = digits.mutable_data();
+    if (shift % BASE) {
+        mpn::lshift(r + q, r, n + 1, shift % BASE);
+    }
+    else {
+        std::copy_backward(r, r + n + 1, r + n + q + 1);
+    }
+    std::fill(r, r + q, 0);
+    trim();
+    return *this;
 }
 
-big_integer& big_integer::operator<<=(digit_t shift) {
-    return *this = *this << shift;
+
+//radix conversion
+
+const char RADIX_DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+//the largest power of base that fits a digit, base^k <= DIGIT_MAX, and its exponent k
+std::pair <digit_t, size_t> radix_chunk(digit_t base) {
+    digit_t chunk = base;
+    size_t k = 1;
+    while (chunk <= DIGIT_MAX / base) {
+        chunk *= base;
+        k++;
+    }
+    return std::make_pair(chunk, k);
 }
 
+//chunk^(2^k) for the chunk of base, the table is filled by squaring and kept between calls; the reference counts
+//are not atomic, so every caller gets digits of its own rather than a copy sharing the buffer of the table
+big_integer radix_power(digit_t base, size_t k) {
+    static std::vector <big_integer> powers[37];
+    static std::mutex powers_lock;
+    std::lock_guard <std::mutex> guard(powers_lock);
+    std::vector <big_integer>& p = powers[base];
+    {
+        //the table outlives any scoped allocator of the caller
+        digit_allocator::scope heap(*digit_allocator::heap());
+        if (p.empty()) {
+            digit_vector chunk(2);
+            chunk.mutable_data()[0] = radix_chunk(base).first;
+            p.push_back(big_integer(false, chunk));
+        }
+        while (p.size() <= k) {
+            p.push_back(p.back().square());
+        }
+    }
+    digit_vector res(p[k].length());
+    digit_t* r = res.mutable_data();
+    for (size_t i = 0; i < res.size(); i++) {
+        r[i] = p[k].get_digit(i);
+    }
+    return big_integer(false, std::move(res));
+}
+
+//appends x >= 0 in the given base, left padded with zeros to width characters,
+//one short division by the chunk per chunk of characters
+void to_string_basecase(big_integer const& x, digit_t base, std::string& out, size_t width) {
+    std::pair <digit_t, size_t> chunk = radix_chunk(base);
+    digit_vector d(x.length());
+    digit_t* p = d.mutable_data();
+    for (size_t i = 0; i < d.size(); i++) {
+        p[i] = x.get_digit(i);
+    }
+    string str;
+    while (!d.empty() && d.data()[d.size() - 1] == 0) {
+        d.pop_back();
+    }
+    while (!d.empty()) {
+        digit_t rem = div_long_short(d, chunk.first, d);
+        for (size_t i = 0; i < chunk.second; i++) {
+            str.push_back(RADIX_DIGITS[rem % base]);
+            rem /= base;
+        }
+        while (!d.empty() && d.data()[d.size() - 1] == 0) {
+            d.pop_back();
+        }
+    }
+    while (!str.empty() && str.back() == '0') {
+        str.pop_back();
+    }
+    if (str.size() < width) {
+        str.append(width - str.size(), '0');
+    }
+    out.append(str.rbegin(), str.rend());
+}
+
+//appends 0 <= x < radix_power(base, k + 1): x is split by radix_power(base, k) into halves converted recursively,
+//the low half is padded to its full width so that the leaves can be written independently
+void to_string_recursive(big_integer const& x, digit_t base, size_t k, std::string& out, bool pad) {
+    big_integer p = radix_power(base, k);
+    if (p.length() < std::max(big_integer::thresholds.dc_to_string, size_t(2))) {
+        to_string_basecase(x, base, out, pad ? radix_chunk(base).second << (k + 1) : 0);
+        return;
+    }
+    if (!pad && x < p) {
+        to_string_recursive(x, base, k - 1, out, false);
+        return;
+    }
+    std::pair <big_integer, big_integer> qr = big_integer::divmod(x, p);
+    to_string_recursive(qr.first, base, k - 1, out, pad);
+    to_string_recursive(qr.second, base, k - 1, out, true);
+}
+
+//appends x > 0 in base 2^bits, reading the characters straight from the bits of the digits
+void to_string_pow2(big_integer const& x, size_t bits, std::string& out) {
+    size_t n = (x.length() * BASE + bits - 1) / bits;
+    bool leading = true;
+    for (size_t i = n; i-- > 0;) {
+        digit_t c = 0;
+        for (size_t j = bits; j-- > 0;) {
+            size_t pos = i * bits + j;
+            c = (c << 1) | ((x.get_digit(pos / BASE) >> (pos % BASE)) & 1);
+        }
+        if (c == 0 && leading) {
+            continue;
+        }
+        leading = false;
+        out.push_back(RADIX_DIGITS[c]);
+    }
+}
+
+string to_string(big_integer const& a, unsigned int base) {
+    if (base < 2 || base > 36) {
+        throw std::runtime_error("Base out of range");
+    }
+    if (a.is_zero()) {
+        return "0";
+    }
+    string str = a.sign() ? "-" : "";
+    big_integer x = a.abs();
+    if ((base & (base - 1)) == 0) {
+        size_t bits = 0;
+        while ((1u << bits) < base) {
+            bits++;
+        }
+        to_string_pow2(x, bits, str);
+        return str;
+    }
+    size_t k = 0;
+    while (radix_power(base, k + 1) <= x) {
+        k++;
+    }
+    to_string_recursive(x, base, k, str, false);
+    return str;
+}
+
+string to_string(big_integer const& a) {
+    return to_string(a, 10);
+}
+
+digit_t radix_value(char c, digit_t base) {
+    digit_t d = base;
+    if (c >= '0' && c <= '9') {
+        d = c - '0';
+    }
+    else if (c >= 'a' && c <= 'z') {
+        d = c - 'a' + 10;
+    }
+    else if (c >= 'A' && c <= 'Z') {
+        d = c - 'A' + 10;
+    }
+    if (d >= base) {
+        throw std::runtime_error("Digit expected");
+    }
+    return d;
+}
+
+//reads str[0, len) in the given base by horner's rule, a whole chunk of characters per pass over the digits
+big_integer from_string_basecase(char const* str, size_t len, digit_t base) {
+    size_t chunk_len = radix_chunk(base).second;
+    digit_vector d;
+    for (size_t i = 0; i < len;) {
+        size_t k = (i == 0 && len % chunk_len ? len % chunk_len : chunk_len);
+        digit_t acc = 0, mul = 1;
+        for (size_t j = 0; j < k; j++) {
+            acc = acc * base + radix_value(str[i + j], base);
+            mul *= base;
+        }
+        double_digit_t carry = acc;
+        digit_t* p = d.mutable_data();
+        for (size_t j = 0; j < d.size(); j++) {
+            carry += double_digit_cast(p[j]) * mul;
+            p[j] = digit_cast(carry);
+            carry >>= BASE;
+        }
+        if (carry) {
+            d.push_back(digit_cast(carry));
+        }
+        i += k;
+    }
+    return big_integer(false, std::move(d));
+}
+
+//the low chunk_len * 2^k characters, where 2^k is the largest power of two below the number of chunks,
+//are read recursively and combined with the high part through the cached radix_power(base, k)
+big_integer from_string_recursive(char const* str, size_t len, digit_t base) {
+    size_t chunk_len = radix_chunk(base).second;
+    size_t chunks = (len + chunk_len - 1) / chunk_len;
+    if (chunks <= std::max(big_integer::thresholds.dc_from_string, size_t(2))) {
+        return from_string_basecase(str, len, base);
+    }
+    size_t k = 0;
+    while ((size_t(2) << k) < chunks) {
+        k++;
+    }
+    size_t low = chunk_len << k;
+    return from_string_recursive(str, len - low, base) * radix_power(base, k)
+           + from_string_recursive(str + len - low, low, base);
+}
+
+//reads str[0, len) in base 2^bits by placing the bits of every character, no multiplications
+big_integer from_string_pow2(char const* str, size_t len, size_t bits) {
+    digit_vector d(len * bits / BASE + 1);
+    digit_t* r = d.mutable_data();
+    size_t pos = 0;
+    for (size_t i = len; i-- > 0; pos += bits) {
+        digit_t c = radix_value(str[i], digit_t(1) << bits);
+        r[pos / BASE] |= c << (pos % BASE);
+        if (pos % BASE + bits > BASE) {
+            r[pos / BASE + 1] |= c >> (BASE - pos % BASE);
+        }
+    }
+    return big_integer(false, std::move(d));
+}
+
+big_integer to_number(char const* str, size_t len, unsigned int base) {
+    if (base < 2 || base > 36) {
+        throw std::runtime_error("Base out of range");
+    }
+    bool new_sign = (len > 0 && str[0] == '-');
+    str += new_sign;
+    len -= new_sign;
+    big_integer new_num;
+    if ((base & (base - 1)) == 0) {
+        size_t bits = 0;
+        while ((1u << bits) < base) {
+            bits++;
+        }
+        new_num = from_string_pow2(str, len, bits);
+    }
+    else {
+        new_num = from_string_recursive(str, len, base);
+    }
+    return new_sign ? -new_num : new_num;
+}
@@ -7,19 +7,49 @@
 
 #include "digit_vector.h"
 #include <string>
+#include <utility>
 
 struct big_integer {
 
-    typedef unsigned int digit_t;
+    //BIGINT_64BIT_DIGITS selects 64-bit digits with 128-bit intermediate products instead of 32-bit ones
+    typedef digit_vector::digit_t digit_t;
+#ifdef BIGINT_64BIT_DIGITS
+    __extension__ typedef unsigned __int128 double_digit_t;
+#else
     typedef unsigned long long double_digit_t;
+#endif
+
+    //digit counts at which multiplication, squaring, division, radix conversion, barrett_reducer and gcd switch
+    //to the next algorithm, may be tuned at runtime
+    struct algorithm_thresholds {
+        size_t karatsuba_mul;
+        size_t toom3_mul;
+        size_t toom4_mul;
+        size_t ntt_mul;
+        size_t karatsuba_sqr;
+        size_t toom3_sqr;
+        size_t toom4_sqr;
+        size_t ntt_sqr;
+        size_t burnikel_ziegler_div;
+        size_t dc_to_string;
+        size_t dc_from_string;
+        size_t barrett_mul;
+        size_t half_gcd;
+    };
+    static algorithm_thresholds thresholds;
 
     big_integer();
     big_integer(big_integer const& other);
+    big_integer(big_integer&& other) noexcept;
     big_integer(bool s, digit_vector const& d);
+    big_integer(bool s, digit_vector&& d);
     big_integer(int x);
-    explicit big_integer(std::string const& str);
+    //digits 0-9 and a-z (either case) for bases from 2 to 36, an optional leading minus
+    explicit big_integer(std::string const& str, unsigned int base = 10);
+    big_integer(char const* first, char const* last, unsigned int base = 10);
 
-    big_integer& operator=(big_integer other);
+    big_integer& operator=(big_integer const& other);
+    big_integer& operator=(big_integer&& other) noexcept;
 
     friend bool operator==(big_integer const& a, big_integer const& b);
     friend bool operator!=(big_integer const& a, big_integer const& b);
@@ -30,17 +60,39 @@ struct big_integer {
 
     friend big_integer operator+(big_integer const& a, big_integer const& b);
     friend big_integer operator-(big_integer const& a, big_integer const& b);
+    //the overloads taking an rvalue reuse its digits for the result
+    friend big_integer operator+(big_integer&& a, big_integer const& b);
+    friend big_integer operator+(big_integer const& a, big_integer&& b);
+    friend big_integer operator+(big_integer&& a, big_integer&& b);
+    friend big_integer operator-(big_integer&& a, big_integer const& b);
+    friend big_integer operator-(big_integer const& a, big_integer&& b);
+    friend big_integer operator-(big_integer&& a, big_integer&& b);
     friend big_integer operator*(big_integer const& a, big_integer const& b);
     friend big_integer operator/(big_integer const& a, big_integer const& b);
     friend big_integer operator%(big_integer const& a, big_integer const& b);
 
+    //quotient rounded towards zero and remainder with the sign of a
+    static std::pair <big_integer, big_integer> divmod(big_integer const& a, big_integer const& b);
+    //same as divmod, reusing the storage of q and r, which must be different objects but may alias a or b
+    static void divmod_to(big_integer& q, big_integer& r, big_integer const& a, big_integer const& b);
+
+    //a * b, or a alone when b is null, added to or subtracted from a sum
+    struct product_term {
+        big_integer const* a;
+        big_integer const* b;
+        bool subtract;
+    };
+    //the sum of count terms accumulated into one result allocated once, see big_integer_expr.h
+    static big_integer sum_of_products(product_term const* terms, size_t count);
+
     template <class FunctorT>
     friend big_integer apply_bitwise(big_integer const& a, big_integer const& b, FunctorT functor) {
         digit_vector res(std::max(a.length(), b.length()));
+        digit_t* r = res.mutable_data();
         for (size_t i = 0; i < res.size(); i++) {
-            res[i] = functor(a.get_digit(i), b.get_digit(i));
+            r[i] = functor(a.get_digit(i), b.get_digit(i));
         }
-        return big_integer(functor(a.sign, b.sign), res);
+        return big_integer(functor(a.sign(), b.sign()), std::move(res));
     }
 
     friend big_integer operator&(big_integer const& a, big_integer const& b);
@@ -48,6 +100,8 @@ struct big_integer {
     friend big_integer operator|(big_integer const& a, big_integer const& b);
     friend big_integer operator>>(big_integer const& a, unsigned int shift);
     friend big_integer operator<<(big_integer const& a, unsigned int shift);
+    friend big_integer operator>>(big_integer&& a, unsigned int shift);
+    friend big_integer operator<<(big_integer&& a, unsigned int shift);
 
     big_integer& operator+=(big_integer const& b);
     big_integer& operator-=(big_integer const& b);
@@ -72,22 +126,38 @@ struct big_integer {
     big_integer operator--(int);
 
     friend std::string to_string(big_integer const& a);
-    friend void swap(big_integer& a, big_integer& b);
+    //digits 0-9 and a-z for bases from 2 to 36
+    friend std::string to_string(big_integer const& a, unsigned int base);
+    friend void swap(big_integer& a, big_integer& b) noexcept;
 
     big_integer abs() const;
-    bool is_zero_digit(unsigned int d) const;
+    big_integer square() const;
+    bool is_zero_digit(digit_t d) const;
     bool is_neg_one() const;
     size_t length() const;
     digit_t get_digit(size_t pos) const;
     bool is_zero() const;
+    //the number of significant bits of the absolute value
+    size_t bit_length() const;
+    //the absolute value modulo a single digit d > 0, without forming the quotient
+    digit_t mod_digit(digit_t d) const;
 
 private:
-    bool sign;
     digit_vector digits;
 
+    //the sign is kept in the tag bit of the digits, next to the length
+    bool sign() const {
+        return digits.tag();
+    }
+
+    void set_sign(bool s) {
+        digits.set_tag(s);
+    }
 
     void trim();
     void normalize();
+    void negate();
+    void add_in_place(big_integer const& b, bool subtract);
 };
 
 #endif //BIGINT_BIG_INTEGER_H
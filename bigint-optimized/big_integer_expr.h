@@ -0,0 +1,139 @@
+//
+// Opt-in expression templates for sums and differences of products
+//
+
+#ifndef BIGINT_BIG_INTEGER_EXPR_H
+#define BIGINT_BIG_INTEGER_EXPR_H
+
+#include "big_integer.h"
+#include <array>
+
+//big_integer r = lazy(a) * b + lazy(c) * d - e; collects the terms and computes them by big_integer::sum_of_products
+//into one result, equal to the one of the eager operators; the terms keep pointers to the operands,
+//so the expression has to be converted in the statement that builds it
+namespace big_integer_expr {
+
+    struct operand {
+        big_integer const* value;
+    };
+
+    inline operand lazy(big_integer const& a) {
+        return {&a};
+    }
+
+    template <size_t N>
+    struct sum {
+        std::array <big_integer::product_term, N> terms;
+
+        operator big_integer() const {
+            return big_integer::sum_of_products(terms.data(), N);
+        }
+    };
+
+    inline sum <1> term(big_integer const* a, big_integer const* b = nullptr) {
+        return {{{{a, b, false}}}};
+    }
+
+    template <size_t N, size_t M>
+    sum <N + M> concat(sum <N> const& a, sum <M> const& b, bool subtract) {
+        sum <N + M> res;
+        for (size_t i = 0; i < N; i++) {
+            res.terms[i] = a.terms[i];
+        }
+        for (size_t i = 0; i < M; i++) {
+            res.terms[N + i] = b.terms[i];
+            res.terms[N + i].subtract ^= subtract;
+        }
+        return res;
+    }
+
+    inline sum <1> operator*(operand a, big_integer const& b) {
+        return term(a.value, &b);
+    }
+
+    inline sum <1> operator*(big_integer const& a, operand b) {
+        return term(&a, b.value);
+    }
+
+    inline sum <1> operator*(operand a, operand b) {
+        return term(a.value, b.value);
+    }
+
+    template <size_t N, size_t M>
+    sum <N + M> operator+(sum <N> const& a, sum <M> const& b) {
+        return concat(a, b, false);
+    }
+
+    template <size_t N, size_t M>
+    sum <N + M> operator-(sum <N> const& a, sum <M> const& b) {
+        return concat(a, b, true);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator+(sum <N> const& a, big_integer const& b) {
+        return concat(a, term(&b), false);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator-(sum <N> const& a, big_integer const& b) {
+        return concat(a, term(&b), true);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator+(big_integer const& a, sum <N> const& b) {
+        return concat(term(&a), b, false);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator-(big_integer const& a, sum <N> const& b) {
+        return concat(term(&a), b, true);
+    }
+
+    //the rvalue overloads win over the rvalue operators of big_integer, the temporary lives until the conversion
+    template <size_t N>
+    sum <N + 1> operator+(sum <N> const& a, big_integer&& b) {
+        return concat(a, term(&b), false);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator-(sum <N> const& a, big_integer&& b) {
+        return concat(a, term(&b), true);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator+(big_integer&& a, sum <N> const& b) {
+        return concat(term(&a), b, false);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator-(big_integer&& a, sum <N> const& b) {
+        return concat(term(&a), b, true);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator+(sum <N> const& a, operand b) {
+        return concat(a, term(b.value), false);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator-(sum <N> const& a, operand b) {
+        return concat(a, term(b.value), true);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator+(operand a, sum <N> const& b) {
+        return concat(term(a.value), b, false);
+    }
+
+    template <size_t N>
+    sum <N + 1> operator-(operand a, sum <N> const& b) {
+        return concat(term(a.value), b, true);
+    }
+
+    template <size_t N>
+    sum <N> operator-(sum <N> const& a) {
+        return concat(sum <0>(), a, true);
+    }
+}
+
+#endif //BIGINT_BIG_INTEGER_EXPR_H
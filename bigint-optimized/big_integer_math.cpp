@@ -0,0 +1,1025 @@
+//
+// Number theory on big integers
+//
+
+#include "big_integer_math.h"
+#include "mpn.h"
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+typedef big_integer::digit_t digit_t;
+typedef big_integer::double_digit_t double_digit_t;
+
+const size_t BASE = std::numeric_limits <digit_t>::digits;
+const digit_t DIGIT_MAX = std::numeric_limits <digit_t>::max();
+
+//scratch space comes from the current digit_allocator as well
+typedef std::vector <digit_t, allocator_adaptor <digit_t>> scratch_vector;
+
+namespace {
+    big_integer from_double_digit(double_digit_t x) {
+        digit_vector d(2);
+        digit_t* r = d.mutable_data();
+        r[0] = static_cast <digit_t> (x);
+        r[1] = static_cast <digit_t> (x >> BASE);
+        return big_integer(false, std::move(d));
+    }
+
+    double_digit_t to_double_digit(big_integer const& x) {
+        return x.get_digit(0) | (static_cast <double_digit_t> (x.get_digit(1)) << BASE);
+    }
+
+    //a[0, n) >> p for a value that fits in a double digit after the shift
+    double_digit_t top_bits(digit_t const* a, size_t n, size_t p) {
+        size_t d = p / BASE;
+        size_t shift = p % BASE;
+        auto digit = [&](size_t i) {
+            return static_cast <double_digit_t> (i < n ? a[i] : 0);
+        };
+        double_digit_t res = (digit(d) >> shift) | (digit(d + 1) << (BASE - shift));
+        if (shift != 0) {
+            res |= digit(d + 2) << (2 * BASE - shift);
+        }
+        return res;
+    }
+
+    double_digit_t top_bits(big_integer const& x, size_t p) {
+        size_t d = p / BASE;
+        digit_t t[] = {x.get_digit(d), x.get_digit(d + 1), x.get_digit(d + 2)};
+        return top_bits(t, 3, p % BASE);
+    }
+
+    size_t significant(digit_t const* a, size_t n) {
+        while (n > 0 && a[n - 1] == 0) {
+            n--;
+        }
+        return n;
+    }
+
+    big_integer from_digits(digit_t const* a, size_t n) {
+        digit_vector d(n);
+        std::copy(a, a + n, d.mutable_data());
+        return big_integer(false, std::move(d));
+    }
+
+    size_t bit_length(double_digit_t x) {
+        size_t bits = 0;
+        for (; x != 0; x >>= 1) {
+            bits++;
+        }
+        return bits;
+    }
+
+    big_integer power_of_two(size_t k) {
+        return big_integer(1) << static_cast <unsigned int> (k);
+    }
+
+    //the reduction of the half gcd: a pair (a, b) is replaced by (α, β) with (a, b) = M (α, β), where M
+    //is a product of the steps (1 q; 0 1) and (1 0; q 1), so it has a determinant of one and no negative entries
+    struct matrix {
+        big_integer m[2][2];
+
+        matrix() {
+            m[0][0] = 1;
+            m[1][1] = 1;
+        }
+    };
+
+    //m = m * n
+    void mul_matrix(matrix& m, matrix const& n) {
+        for (size_t i = 0; i < 2; i++) {
+            big_integer r0 = m.m[i][0] * n.m[0][0] + m.m[i][1] * n.m[1][0];
+            big_integer r1 = m.m[i][0] * n.m[0][1] + m.m[i][1] * n.m[1][1];
+            m.m[i][0] = std::move(r0);
+            m.m[i][1] = std::move(r1);
+        }
+    }
+
+    //(x, y) = M^-1 (x, y)
+    void apply_inverse(matrix const& m, big_integer& x, big_integer& y) {
+        big_integer r = m.m[1][1] * x - m.m[0][1] * y;
+        y = m.m[0][0] * y - m.m[1][0] * x;
+        x = std::move(r);
+    }
+
+    //(a, b) = M^-1 (a, b) where (a >> p, b >> p) = M (A, B): only the low p bits are multiplied by the matrix
+    void adjust(big_integer& a, big_integer& b, big_integer const& A, big_integer const& B, matrix const& m, size_t p) {
+        big_integer mask = power_of_two(p) - 1;
+        big_integer a0 = a & mask;
+        big_integer b0 = b & mask;
+        apply_inverse(m, a0, b0);
+        a = (A << static_cast <unsigned int> (p)) + a0;
+        b = (B << static_cast <unsigned int> (p)) + b0;
+    }
+
+    //the reduction of a, b < 2^(2 BASE) computed exactly in double digits, the entries of m are below B
+    bool hgcd_native(double_digit_t& a, double_digit_t& b, double_digit_t m[2][2]) {
+        m[0][0] = m[1][1] = 1;
+        m[0][1] = m[1][0] = 0;
+        double_digit_t bound = static_cast <double_digit_t> (1) << (bit_length(std::max(a, b)) / 2 + 1);
+        if (std::min(a, b) <= bound) {
+            return false;
+        }
+        bool changed = false;
+        while (true) {
+            if (a >= b) {
+                if (a - b <= bound) {
+                    break;
+                }
+                double_digit_t q = (a - bound - 1) / b;
+                a -= q * b;
+                m[0][1] += q * m[0][0];
+                m[1][1] += q * m[1][0];
+            }
+            else {
+                if (b - a <= bound) {
+                    break;
+                }
+                double_digit_t q = (b - bound - 1) / a;
+                b -= q * a;
+                m[0][0] += q * m[0][1];
+                m[1][0] += q * m[1][1];
+            }
+            changed = true;
+        }
+        return changed;
+    }
+
+    //the reduction of the top two digits of a and b after dropping p bits
+    bool lehmer_matrix(big_integer const& a, big_integer const& b, size_t p, matrix& m) {
+        double_digit_t x = top_bits(a, p);
+        double_digit_t y = top_bits(b, p);
+        double_digit_t r[2][2];
+        if (!hgcd_native(x, y, r)) {
+            return false;
+        }
+        for (size_t i = 0; i < 2; i++) {
+            for (size_t j = 0; j < 2; j++) {
+                m.m[i][j] = from_double_digit(r[i][j]);
+            }
+        }
+        return true;
+    }
+
+    //the larger value loses as many multiples of the smaller one as leave it above the bound,
+    //false when their difference is already within the bound
+    bool hgcd_step(big_integer& a, big_integer& b, matrix& m, big_integer const& bound) {
+        bool first = a >= b;
+        big_integer& x = (first ? a : b);
+        big_integer& y = (first ? b : a);
+        std::pair <big_integer, big_integer> qr = big_integer::divmod(x - bound - 1, y);
+        if (qr.first.is_zero()) {
+            return false;
+        }
+        x = qr.second + bound + 1;
+        size_t to = (first ? 1 : 0);
+        m.m[0][to] += qr.first * m.m[0][1 - to];
+        m.m[1][to] += qr.first * m.m[1][1 - to];
+        return true;
+    }
+
+    //Lehmer's algorithm for the half gcd on digit spans: the reductions of the top two digits are applied
+    //to the values and multiplied into m, which starts as the identity, as long as they keep the values above 2^s
+    bool hgcd_lehmer(big_integer& a, big_integer& b, matrix& m, size_t s) {
+        size_t n = std::max(a.length(), b.length());
+        size_t mn = n / 2 + 2;
+        scratch_vector x(n + 1), y(n + 1), t(n + 1), u(n + 1);
+        std::vector <scratch_vector> e(4, scratch_vector(mn + 1));
+        std::vector <scratch_vector> next(4, scratch_vector(mn + 1));
+        for (size_t i = 0; i < n; i++) {
+            x[i] = a.get_digit(i);
+            y[i] = b.get_digit(i);
+        }
+        e[0][0] = e[3][0] = 1;
+        size_t en = 1;
+
+        bool changed = false;
+        while (true) {
+            size_t len = std::max((n - 1) * BASE + bit_length(x[n - 1]), (n - 1) * BASE + bit_length(y[n - 1]));
+            size_t p = std::max(2 * s - len + 1, len > 2 * BASE ? len - 2 * BASE : 0);
+            double_digit_t c = top_bits(x.data(), n, p);
+            double_digit_t d = top_bits(y.data(), n, p);
+            double_digit_t r[2][2];
+            if (!hgcd_native(c, d, r)) {
+                break;
+            }
+            digit_t r00 = static_cast <digit_t> (r[0][0]);
+            digit_t r01 = static_cast <digit_t> (r[0][1]);
+            digit_t r10 = static_cast <digit_t> (r[1][0]);
+            digit_t r11 = static_cast <digit_t> (r[1][1]);
+
+            //(x, y) = R^-1 (x, y), both stay positive
+            t[n] = mpn::mul_1(t.data(), x.data(), n, r11);
+            t[n] -= mpn::submul_1(t.data(), y.data(), n, r01);
+            u[n] = mpn::mul_1(u.data(), y.data(), n, r00);
+            u[n] -= mpn::submul_1(u.data(), x.data(), n, r10);
+            x.swap(t);
+            y.swap(u);
+            while (n > 1 && x[n - 1] == 0 && y[n - 1] == 0) {
+                n--;
+            }
+
+            //M = M * R, the entries grow by at most a digit
+            for (size_t i = 0; i < 4; i += 2) {
+                next[i][en] = mpn::mul_1(next[i].data(), e[i].data(), en, r00);
+                next[i][en] += mpn::addmul_1(next[i].data(), e[i + 1].data(), en, r10);
+                next[i + 1][en] = mpn::mul_1(next[i + 1].data(), e[i].data(), en, r01);
+                next[i + 1][en] += mpn::addmul_1(next[i + 1].data(), e[i + 1].data(), en, r11);
+            }
+            e.swap(next);
+            if (e[0][en] != 0 || e[1][en] != 0 || e[2][en] != 0 || e[3][en] != 0) {
+                en++;
+            }
+            changed = true;
+        }
+        if (changed) {
+            a = from_digits(x.data(), n);
+            b = from_digits(y.data(), n);
+            for (size_t i = 0; i < 4; i++) {
+                m.m[i / 2][i % 2] = from_digits(e[i].data(), en);
+            }
+        }
+        return changed;
+    }
+
+    bool hgcd(big_integer& a, big_integer& b, matrix& m);
+
+    //hgcd of the values shifted right by p bits, its matrix reduces (a, b) to values of at least
+    //p + floor(k / 2) bits, k being the length of the shifted values
+    bool hgcd_top(big_integer& a, big_integer& b, matrix& m, size_t p) {
+        big_integer A = a >> static_cast <unsigned int> (p);
+        big_integer B = b >> static_cast <unsigned int> (p);
+        if (!hgcd(A, B, m)) {
+            return false;
+        }
+        adjust(a, b, A, B, m, p);
+        return true;
+    }
+
+    //reduces a, b > 0 to α, β > 2^s with |α - β| <= 2^s, s = floor(n / 2) + 1 for the length n of max(a, b),
+    //which leaves them about half as long; false when they are not above 2^s or no step is possible.
+    //a matrix M found for the top k bits of the values after dropping p low bits, with its reduced pair
+    //above 2^s' for s' = floor(k / 2) + 1, has entries below 2^(k - s'), so it moves the pair by less than
+    //2^(p + k - s') from 2^p times the reduced one and leaves it above 2^(p + s' - 1) [Möller, 2008]
+    bool hgcd(big_integer& a, big_integer& b, matrix& m) {
+        size_t n = std::max(a.bit_length(), b.bit_length());
+        size_t s = n / 2 + 1;
+        big_integer bound = power_of_two(s);
+        if (std::min(a, b) <= bound) {
+            return false;
+        }
+        if (n <= 2 * BASE) {
+            double_digit_t x = to_double_digit(a);
+            double_digit_t y = to_double_digit(b);
+            double_digit_t r[2][2];
+            if (!hgcd_native(x, y, r)) {
+                return false;
+            }
+            a = from_double_digit(x);
+            b = from_double_digit(y);
+            for (size_t i = 0; i < 2; i++) {
+                for (size_t j = 0; j < 2; j++) {
+                    m.m[i][j] = from_double_digit(r[i][j]);
+                }
+            }
+            return true;
+        }
+
+        bool changed = false;
+        if (n >= big_integer::thresholds.half_gcd * BASE) {
+            //the top half brings the values down to about 3n / 4 bits, single steps and the top of the rest
+            //to about n / 2; a pair that no step can reduce is already done
+            changed = hgcd_top(a, b, m, n / 2);
+            while (std::max(a.bit_length(), b.bit_length()) > 3 * n / 4 + 1) {
+                if (!hgcd_step(a, b, m, bound)) {
+                    return changed;
+                }
+                changed = true;
+            }
+            size_t len = std::max(a.bit_length(), b.bit_length());
+            matrix next;
+            if (len > s + 2 && hgcd_top(a, b, next, 2 * s - len + 1)) {
+                mul_matrix(m, next);
+                changed = true;
+            }
+        }
+        else {
+            changed = hgcd_lehmer(a, b, m, s);
+        }
+        while (hgcd_step(a, b, m, bound)) {
+            changed = true;
+        }
+        return changed;
+    }
+
+    //Lehmer's algorithm on digit spans for x >= y > 0: the matrix of the top two digits costs two
+    //multiplications by a digit per value, a division step takes over for values of different lengths;
+    //the digits of b above its length are kept zero up to the length of a
+    big_integer lehmer_gcd(big_integer const& x, big_integer const& y) {
+        size_t n = x.length();
+        scratch_vector a(n + 1), b(n + 1), t(n + 1), u(n + 1), q(n + 1);
+        scratch_vector scratch(mpn::divrem_itch(n, n));
+        for (size_t i = 0; i < n; i++) {
+            a[i] = x.get_digit(i);
+            b[i] = y.get_digit(i);
+        }
+        size_t an = n;
+        size_t bn = significant(b.data(), n);
+        while (bn != 0) {
+            if (an <= 2) {
+                double_digit_t c = top_bits(a.data(), an, 0);
+                double_digit_t d = top_bits(b.data(), bn, 0);
+                while (d != 0) {
+                    double_digit_t r = c % d;
+                    c = d;
+                    d = r;
+                }
+                return from_double_digit(c);
+            }
+
+            size_t p = (an - 2) * BASE - (BASE - bit_length(a[an - 1]));
+            double_digit_t c = top_bits(a.data(), an, p);
+            double_digit_t d = top_bits(b.data(), bn, p);
+            double_digit_t r[2][2];
+            if (hgcd_native(c, d, r)) {
+                t[an] = mpn::mul_1(t.data(), a.data(), an, static_cast <digit_t> (r[1][1]));
+                t[an] -= mpn::submul_1(t.data(), b.data(), an, static_cast <digit_t> (r[0][1]));
+                u[an] = mpn::mul_1(u.data(), b.data(), an, static_cast <digit_t> (r[0][0]));
+                u[an] -= mpn::submul_1(u.data(), a.data(), an, static_cast <digit_t> (r[1][0]));
+                a.swap(t);
+                b.swap(u);
+                bn = significant(b.data(), an);
+                an = significant(a.data(), an);
+            }
+            else {
+                mpn::divrem(q.data(), t.data(), a.data(), an, b.data(), bn, scratch.data());
+                a.swap(b);
+                b.swap(t);
+                an = bn;
+                bn = significant(b.data(), an);
+            }
+            if (bn > an || (bn == an && mpn::cmp_n(a.data(), b.data(), an) < 0)) {
+                a.swap(b);
+                std::swap(an, bn);
+            }
+        }
+        return from_digits(a.data(), an);
+    }
+
+    //brings x, y >= 0 down to (gcd, 0) by the inverses of matrices of determinant one, which are applied
+    //to the cofactors (s0, s1) as well when those are given
+    big_integer gcd_reduce(big_integer x, big_integer y, big_integer* s0, big_integer* s1) {
+        while (!y.is_zero()) {
+            if (x < y) {
+                swap(x, y);
+                if (s0 != nullptr) {
+                    swap(*s0, *s1);
+                }
+                //x was zero
+                if (y.is_zero()) {
+                    break;
+                }
+            }
+            //the reduction of the top two thirds leaves about two thirds of the length
+            size_t n = x.bit_length();
+            bool fast = n >= big_integer::thresholds.half_gcd * BASE;
+            if (s0 == nullptr && !fast) {
+                return lehmer_gcd(x, y);
+            }
+            matrix m;
+            if (fast) {
+                size_t p = n / 3;
+                big_integer A = x >> static_cast <unsigned int> (p);
+                big_integer B = y >> static_cast <unsigned int> (p);
+                if (hgcd(A, B, m)) {
+                    adjust(x, y, A, B, m, p);
+                    if (s0 != nullptr) {
+                        apply_inverse(m, *s0, *s1);
+                    }
+                    continue;
+                }
+            }
+            else if (lehmer_matrix(x, y, n > 2 * BASE ? n - 2 * BASE : 0, m)) {
+                apply_inverse(m, x, y);
+                apply_inverse(m, *s0, *s1);
+                continue;
+            }
+
+            //values of different lengths or too close to each other for a reduction
+            std::pair <big_integer, big_integer> qr = big_integer::divmod(x, y);
+            x = std::move(y);
+            y = std::move(qr.second);
+            if (s0 != nullptr) {
+                big_integer r = *s0 - qr.first * *s1;
+                *s0 = std::move(*s1);
+                *s1 = std::move(r);
+            }
+        }
+        return x;
+    }
+}
+
+big_integer gcd(big_integer const& a, big_integer const& b) {
+    return gcd_reduce(a.abs(), b.abs(), nullptr, nullptr);
+}
+
+big_integer lcm(big_integer const& a, big_integer const& b) {
+    if (a.is_zero() || b.is_zero()) {
+        return 0;
+    }
+    return a.abs() / gcd(a, b) * b.abs();
+}
+
+//only the cofactor of a is followed through the reduction, the one of b is recovered by a division at the end
+big_integer gcdext(big_integer const& a, big_integer const& b, big_integer& s, big_integer& t) {
+    if (b.is_zero()) {
+        s = (a < 0 ? -1 : (a.is_zero() ? 0 : 1));
+        t = 0;
+        return a.abs();
+    }
+    big_integer s0 = 1;
+    big_integer s1 = 0;
+    big_integer g = gcd_reduce(a.abs(), b.abs(), &s0, &s1);
+    if (a < 0) {
+        s0 = -s0;
+    }
+
+    //the cofactor closest to zero
+    big_integer period = b.abs() / g;
+    s0 %= period;
+    if (s0 < 0) {
+        s0 += period;
+    }
+    if (s0 * 2 > period) {
+        s0 -= period;
+    }
+    t = (g - a * s0) / b;
+    s = std::move(s0);
+    return g;
+}
+
+namespace {
+    size_t trailing_zeros(big_integer const& x) {
+        size_t i = 0;
+        while (x.get_digit(i) == 0) {
+            i++;
+        }
+        size_t bits = i * BASE;
+        for (digit_t d = x.get_digit(i); (d & 1) == 0; d >>= 1) {
+            bits++;
+        }
+        return bits;
+    }
+
+    //b^e for an odd b > 1 of bn <= 2 digits and e >= 1, left to right on digit spans: e is read in windows
+    //of w bits, each costing w squarings and one multiplication by the power of b it stands for, which
+    //takes a single mul_1 when the table of b^0, ..., b^(2^w - 1) fits in digits
+    big_integer span_pow(digit_t const* b, size_t bn, unsigned long e) {
+        std::vector <digit_t> table(1, 1);
+        size_t w = 0;
+        if (bn == 1) {
+            const size_t max_window = 8;
+            while (w < max_window) {
+                size_t next = table.size() * 2;
+                while (table.size() < next && table.back() <= std::numeric_limits <digit_t>::max() / b[0]) {
+                    table.push_back(table.back() * b[0]);
+                }
+                if (table.size() < next) {
+                    break;
+                }
+                w++;
+            }
+            table.resize(size_t(1) << w);
+        }
+        else {
+            w = 1;
+        }
+
+        size_t n = e * (BASE * (bn - 1) + bit_length(b[bn - 1])) / BASE + 3;
+        scratch_vector x(n);
+        scratch_vector y(n);
+        scratch_vector scratch(mpn::sqr_itch(n / 2 + 1));
+        size_t len = 0;
+        auto mul_window = [&](size_t window) {
+            if (bn == 2) {
+                y[len] = mpn::mul_1(y.data(), x.data(), len, b[0]);
+                y[len + 1] = mpn::addmul_1(y.data() + 1, x.data(), len, b[1]);
+                len += 2;
+                std::swap(x, y);
+            }
+            else {
+                x[len] = mpn::mul_1(x.data(), x.data(), len, table[window]);
+                len++;
+            }
+            len = significant(x.data(), len);
+        };
+
+        size_t i = bit_length(e);
+        size_t k = (i % w == 0 ? w : i % w);
+        x[0] = 1;
+        len = 1;
+        while (i > 0) {
+            size_t window = (e >> (i - k)) & ((size_t(1) << k) - 1);
+            for (size_t j = 0; j < k && (len > 1 || x[0] != 1); j++) {
+                mpn::sqr(y.data(), x.data(), len, scratch.data());
+                len = significant(y.data(), 2 * len);
+                std::swap(x, y);
+            }
+            if (window != 0) {
+                mul_window(window);
+            }
+            i -= k;
+            k = w;
+        }
+        return from_digits(x.data(), len);
+    }
+}
+
+big_integer pow(big_integer const& base, unsigned long e) {
+    if (e == 0) {
+        return 1;
+    }
+    if (base.is_zero()) {
+        return 0;
+    }
+    size_t shift = trailing_zeros(base);
+    big_integer odd = base.abs() >> static_cast <unsigned int> (shift);
+    big_integer res;
+    size_t bits = odd.bit_length();
+    if (bits == 1) {
+        res = 1;
+    }
+    else if (bits <= 2 * BASE) {
+        digit_t b[] = {odd.get_digit(0), odd.get_digit(1)};
+        res = span_pow(b, (bits <= BASE ? 1 : 2), e);
+    }
+    else {
+        res = odd;
+        for (size_t i = bit_length(e) - 1; i > 0; i--) {
+            res = res.square();
+            if (((e >> (i - 1)) & 1) != 0) {
+                res *= odd;
+            }
+        }
+    }
+    res <<= static_cast <unsigned int> (shift * e);
+    if (base < 0 && e % 2 == 1) {
+        res = -res;
+    }
+    return res;
+}
+
+big_integer pow_ui(unsigned long base, unsigned long e) {
+    if (e == 0) {
+        return 1;
+    }
+    if (base == 0) {
+        return 0;
+    }
+    size_t shift = 0;
+    for (; (base & 1) == 0; base >>= 1) {
+        shift++;
+    }
+    big_integer res = 1;
+    if (base > 1) {
+        //a base wider than a digit is split in two, shifting twice keeps the shift below the width of the type
+        digit_t b[] = {static_cast <digit_t> (base), static_cast <digit_t> ((base >> (BASE - 1)) >> 1)};
+        res = span_pow(b, (b[1] == 0 ? 1 : 2), e);
+    }
+    return res << static_cast <unsigned int> (shift * e);
+}
+
+namespace {
+    //floor(x^(1/k)) for k >= 2, one bit at a time from the top
+    double_digit_t native_root(double_digit_t x, unsigned int k) {
+        double_digit_t r = 0;
+        for (size_t b = bit_length(x) / k + 1; b-- > 0;) {
+            double_digit_t c = r | (static_cast <double_digit_t> (1) << b);
+            double_digit_t p = 1;
+            bool fits = true;
+            for (unsigned int i = 0; i < k && fits; i++) {
+                fits = (p <= x / c);
+                p *= c;
+            }
+            if (fits) {
+                r = c;
+            }
+        }
+        return r;
+    }
+
+    //floor(x^(1/k)) of at most bits bits, one bit at a time from the top
+    big_integer bitwise_root(big_integer const& x, unsigned int k, size_t bits) {
+        big_integer r = 0;
+        for (size_t b = bits; b-- > 0;) {
+            big_integer c = r + power_of_two(b);
+            if (pow(c, k) <= x) {
+                r = std::move(c);
+            }
+        }
+        return r;
+    }
+
+    //((k - 1) r + x / r^(k - 1)) / k is never below floor(x^(1/k)) for any r > 0 and is below r whenever r is
+    //above the root
+    big_integer newton_step(big_integer const& x, unsigned int k, big_integer const& r) {
+        if (k == 2) {
+            return (r + x / r) >> 1;
+        }
+        int d = static_cast <int> (k);
+        return (r * (d - 1) + x / pow(r, k - 1)) / d;
+    }
+
+    //floor(x^(1/k)) or a few units above it for x > 0 and 2 <= k < the bit length of x: the root of the top part
+    //of x is found at half the precision and shifted into place, a single Newton step from that estimate at full
+    //precision doubles the number of correct bits
+    big_integer root_estimate(big_integer const& x, unsigned int k) {
+        size_t n = x.bit_length();
+        if (n <= 2 * BASE) {
+            return from_double_digit(native_root(to_double_digit(x), k));
+        }
+        //the root has m bits or m - 1, an estimate h bits short of it off by e units leaves the step
+        //off by about k e^2 / 2^(m - 2h) units
+        size_t m = (n + k - 1) / k;
+        size_t lg = bit_length(k);
+        if (m < lg + 7) {
+            return bitwise_root(x, k, m);
+        }
+        unsigned int h = static_cast <unsigned int> ((m - lg - 5) / 2);
+        big_integer r = root_estimate(x >> (h * k), k) << h;
+        return newton_step(x, k, r);
+    }
+
+    //floor(x^(1/k)) for x >= 0 and k >= 1 and its k-th power p
+    big_integer root(big_integer const& x, unsigned int k, big_integer& p) {
+        if (k == 1 || x.bit_length() <= k) {
+            //below 2^k the root is one unless x is zero
+            big_integer r = (k == 1 || x.is_zero() ? x : big_integer(1));
+            p = r;
+            return r;
+        }
+        big_integer r = root_estimate(x, k);
+        p = pow(r, k);
+        while (p > x) {
+            if (k == 2) {
+                r -= 1;
+                p -= r * 2 + 1;
+            }
+            else {
+                r = newton_step(x, k, r);
+                p = pow(r, k);
+            }
+        }
+        return r;
+    }
+
+    //whether a is the square of some integer modulo m
+    bool is_square_mod(digit_t a, digit_t m) {
+        for (digit_t j = 0; j < m; j++) {
+            if (j * j % m == a) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+big_integer isqrt(big_integer const& x) {
+    return iroot(x, 2);
+}
+
+big_integer isqrt_rem(big_integer const& x, big_integer& rem) {
+    if (x < 0) {
+        throw std::runtime_error("Even root of a negative number");
+    }
+    big_integer p;
+    big_integer r = root(x, 2, p);
+    rem = x - p;
+    return r;
+}
+
+big_integer iroot(big_integer const& x, unsigned int k) {
+    if (k == 0) {
+        throw std::runtime_error("Zeroth root");
+    }
+    if (x < 0) {
+        if (k % 2 == 0) {
+            throw std::runtime_error("Even root of a negative number");
+        }
+        return -iroot(-x, k);
+    }
+    big_integer p;
+    return root(x, k, p);
+}
+
+//squares take 12 of the 64 residues modulo 64 and (p + 1) / 2 of the p residues modulo an odd prime p,
+//so the residues modulo 64 and the primes up to 23 let through about one non-square in 700
+bool is_perfect_square(big_integer const& x) {
+    if (x < 0) {
+        return false;
+    }
+    if (!is_square_mod(x.get_digit(0) % 64, 64)) {
+        return false;
+    }
+    const digit_t primes[] = {3, 5, 7, 11, 13, 17, 19, 23};
+    digit_t rem = x.mod_digit(3 * 5 * 7 * 11 * 13 * 17 * 19 * 23);
+    for (digit_t p : primes) {
+        if (!is_square_mod(rem % p, p)) {
+            return false;
+        }
+    }
+    big_integer r;
+    isqrt_rem(x, r);
+    return r.is_zero();
+}
+
+namespace {
+    //the products of up to this many digits are accumulated with mul_1
+    const size_t PRODUCT_LEAF = 16;
+
+    void check_fits_digit(unsigned long n) {
+        if (n > DIGIT_MAX) {
+            throw std::runtime_error("Argument does not fit in a digit");
+        }
+    }
+
+    //the sieve of Eratosthenes
+    std::vector <digit_t> primes_up_to(digit_t n) {
+        std::vector <bool> composite(n + 1);
+        std::vector <digit_t> primes;
+        for (digit_t p = 2; p <= n; p++) {
+            if (composite[p]) {
+                continue;
+            }
+            primes.push_back(p);
+            for (digit_t q = p; q <= n / p; q++) {
+                composite[p * q] = true;
+            }
+        }
+        return primes;
+    }
+
+    //multiplies the last word by f while the product fits in a digit, so that the leaves have full digits
+    void push_factor(std::vector <digit_t>& words, digit_t f) {
+        if (!words.empty() && words.back() <= DIGIT_MAX / f) {
+            words.back() *= f;
+        }
+        else {
+            words.push_back(f);
+        }
+    }
+
+    //the product of w[0, count), halves of equal numbers of full digits keep the multiplications balanced
+    big_integer product(digit_t const* w, size_t count) {
+        if (count <= PRODUCT_LEAF) {
+            scratch_vector r(count + 1);
+            r[0] = 1;
+            size_t len = 1;
+            for (size_t i = 0; i < count; i++) {
+                r[len] = mpn::mul_1(r.data(), r.data(), len, w[i]);
+                len = significant(r.data(), len + 1);
+            }
+            return from_digits(r.data(), len);
+        }
+        size_t half = count / 2;
+        return product(w, half) * product(w + half, count - half);
+    }
+
+    //the left half goes to a new thread along with half of the threads, the results are moved back,
+    //so no digit buffer is shared between the threads
+    big_integer parallel_product(digit_t const* w, size_t count, unsigned int threads) {
+        if (threads <= 1 || count <= PRODUCT_LEAF) {
+            return product(w, count);
+        }
+        size_t half = count / 2;
+        std::future <big_integer> left = std::async(std::launch::async, parallel_product, w, half, threads / 2);
+        big_integer right = parallel_product(w + half, count - half, threads - threads / 2);
+        return left.get() * right;
+    }
+
+    //the odd part of the swing n! / (floor(n / 2)!)^2: an odd prime p appears in it as many times as there are
+    //odd numbers among floor(n / p), floor(n / p^2), ..., and that power of p is at most n
+    big_integer odd_swing(digit_t n, std::vector <digit_t> const& primes, unsigned int threads) {
+        std::vector <digit_t> words;
+        for (size_t i = 1; i < primes.size() && primes[i] <= n; i++) {
+            digit_t p = primes[i];
+            digit_t f = 1;
+            for (digit_t q = n / p; q > 0; q /= p) {
+                if ((q & 1) != 0) {
+                    f *= p;
+                }
+            }
+            if (f > 1) {
+                push_factor(words, f);
+            }
+        }
+        return parallel_product(words.data(), words.size(), threads);
+    }
+
+    //n! = (floor(n / 2)!)^2 * swing(n), the factors of two are left out
+    big_integer odd_factorial(digit_t n, std::vector <digit_t> const& primes, unsigned int threads) {
+        if (n < 2) {
+            return 1;
+        }
+        return odd_factorial(n / 2, primes, threads).square() * odd_swing(n, primes, threads);
+    }
+
+    size_t popcount(unsigned long n) {
+        size_t res = 0;
+        for (; n != 0; n &= n - 1) {
+            res++;
+        }
+        return res;
+    }
+}
+
+big_integer factorial(unsigned long n, unsigned int threads) {
+    check_fits_digit(n);
+    std::vector <digit_t> primes = primes_up_to(static_cast <digit_t> (n));
+    big_integer res = odd_factorial(static_cast <digit_t> (n), primes, threads);
+    //the twos of n! number n minus the ones in its binary representation
+    return res << static_cast <unsigned int> (n - popcount(n));
+}
+
+//a prime p appears in C(n, k) once for every carry when k and n - k are added in base p, that power of p
+//is at most n; a small k skips the sieve and divides the product of n - k + 1, ..., n by k! instead
+big_integer binomial(unsigned long n, unsigned long k, unsigned int threads) {
+    if (k > n) {
+        return 0;
+    }
+    check_fits_digit(n);
+    k = std::min(k, n - k);
+    std::vector <digit_t> words;
+    if (k <= n / 64) {
+        for (unsigned long i = n - k + 1; i <= n; i++) {
+            push_factor(words, static_cast <digit_t> (i));
+        }
+        return parallel_product(words.data(), words.size(), threads) / factorial(k, threads);
+    }
+    std::vector <digit_t> primes = primes_up_to(static_cast <digit_t> (n));
+    for (digit_t p : primes) {
+        digit_t f = 1;
+        for (unsigned long a = n / p, b = k / p, c = (n - k) / p; a > 0; a /= p, b /= p, c /= p) {
+            if (a != b + c) {
+                f *= p;
+            }
+        }
+        if (f > 1) {
+            push_factor(words, f);
+        }
+    }
+    return parallel_product(words.data(), words.size(), threads);
+}
+
+big_integer primorial(unsigned long n, unsigned int threads) {
+    check_fits_digit(n);
+    std::vector <digit_t> words;
+    for (digit_t p : primes_up_to(static_cast <digit_t> (n))) {
+        push_factor(words, p);
+    }
+    return parallel_product(words.data(), words.size(), threads);
+}
+
+namespace {
+    //f(first, last) on consecutive parts of [0, count), one for each of up to threads threads
+    template <class FunctionT>
+    void parallel_for(size_t count, unsigned int threads, FunctionT f) {
+        size_t parts = std::max(size_t(1), std::min(size_t(threads), count));
+        std::vector <std::future <void>> parts_done;
+        for (size_t t = 1; t < parts; t++) {
+            parts_done.push_back(std::async(std::launch::async, f, count * t / parts, count * (t + 1) / parts));
+        }
+        f(0, count / parts);
+        for (std::future <void>& part : parts_done) {
+            part.get();
+        }
+    }
+}
+
+//the tree works on digit spans, so the threads never copy a big_integer and share no reference counts
+product_tree::product_tree(big_integer const* xs, size_t count, unsigned int threads) {
+    levels.emplace_back();
+    level& leaves = levels.back();
+    leaves.offsets.push_back(0);
+    for (size_t i = 0; i < count; i++) {
+        if (xs[i] <= 0) {
+            throw std::runtime_error("Values must be positive");
+        }
+        leaves.lengths.push_back((xs[i].bit_length() + BASE - 1) / BASE);
+        leaves.offsets.push_back(leaves.offsets.back() + leaves.lengths.back());
+    }
+    leaves.digits.resize(leaves.offsets.back());
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < leaves.lengths[i]; j++) {
+            leaves.digits[leaves.offsets[i] + j] = xs[i].get_digit(j);
+        }
+    }
+
+    while (levels.back().lengths.size() > 1) {
+        level next;
+        level const& prev = levels.back();
+        size_t n = prev.lengths.size();
+        next.offsets.push_back(0);
+        for (size_t i = 0; i < n; i += 2) {
+            size_t len = prev.lengths[i] + (i + 1 < n ? prev.lengths[i + 1] : 0);
+            next.offsets.push_back(next.offsets.back() + len);
+        }
+        next.lengths.resize(next.offsets.size() - 1);
+        next.digits.resize(next.offsets.back());
+
+        parallel_for(next.lengths.size(), threads, [&](size_t first, size_t last) {
+            scratch_vector scratch;
+            for (size_t i = first; i < last; i++) {
+                digit_t* r = next.digits.data() + next.offsets[i];
+                digit_t const* a = prev.digits.data() + prev.offsets[2 * i];
+                size_t an = prev.lengths[2 * i];
+                if (2 * i + 1 == n) {
+                    std::copy(a, a + an, r);
+                    next.lengths[i] = an;
+                    continue;
+                }
+                digit_t const* b = prev.digits.data() + prev.offsets[2 * i + 1];
+                size_t bn = prev.lengths[2 * i + 1];
+                if (an < bn) {
+                    std::swap(a, b);
+                    std::swap(an, bn);
+                }
+                scratch.resize(std::max(scratch.size(), mpn::mul_itch(an, bn)));
+                mpn::mul(r, a, an, b, bn, scratch.data());
+                next.lengths[i] = significant(r, an + bn);
+            }
+        });
+        levels.push_back(std::move(next));
+    }
+}
+
+size_t product_tree::size() const {
+    return levels[0].lengths.size();
+}
+
+big_integer product_tree::root() const {
+    level const& top = levels.back();
+    if (top.lengths.empty()) {
+        return 1;
+    }
+    return from_digits(top.digits.data(), top.lengths[0]);
+}
+
+//a remainder has no more digits than its modulus, so every level of remainders fits in the layout of the tree
+std::vector <big_integer> remainder_tree(big_integer const& x, product_tree const& tree, unsigned int threads) {
+    typedef product_tree::level level;
+    if (tree.size() == 0) {
+        return std::vector <big_integer>();
+    }
+
+    level const& top = tree.levels.back();
+    big_integer r = x.abs() % from_digits(top.digits.data(), top.lengths[0]);
+    std::vector <digit_t> rems(top.digits.size());
+    std::vector <size_t> rem_lengths(1, (r.bit_length() + BASE - 1) / BASE);
+    for (size_t j = 0; j < rem_lengths[0]; j++) {
+        rems[j] = r.get_digit(j);
+    }
+
+    for (size_t k = tree.levels.size() - 1; k-- > 0;) {
+        level const& cur = tree.levels[k + 1];
+        level const& next = tree.levels[k];
+        std::vector <digit_t> next_rems(next.digits.size());
+        std::vector <size_t> next_lengths(next.lengths.size());
+
+        parallel_for(next.lengths.size(), threads, [&](size_t first, size_t last) {
+            scratch_vector q;
+            scratch_vector scratch;
+            for (size_t i = first; i < last; i++) {
+                digit_t const* a = rems.data() + cur.offsets[i / 2];
+                size_t an = rem_lengths[i / 2];
+                digit_t const* b = next.digits.data() + next.offsets[i];
+                size_t bn = next.lengths[i];
+                digit_t* res = next_rems.data() + next.offsets[i];
+                if (an < bn) {
+                    std::copy(a, a + an, res);
+                    next_lengths[i] = an;
+                    continue;
+                }
+                q.resize(std::max(q.size(), an - bn + 1));
+                scratch.resize(std::max(scratch.size(), mpn::divrem_itch(an, bn)));
+                mpn::divrem(q.data(), res, a, an, b, bn, scratch.data());
+                next_lengths[i] = significant(res, bn);
+            }
+        });
+        rems.swap(next_rems);
+        rem_lengths.swap(next_lengths);
+    }
+
+    level const& leaves = tree.levels[0];
+    std::vector <big_integer> res(tree.size());
+    for (size_t i = 0; i < res.size(); i++) {
+        res[i] = from_digits(rems.data() + leaves.offsets[i], rem_lengths[i]);
+        if (x < 0 && !res[i].is_zero()) {
+            res[i] = from_digits(leaves.digits.data() + leaves.offsets[i], leaves.lengths[i]) - res[i];
+        }
+    }
+    return res;
+}
@@ -0,0 +1,70 @@
+//
+// Number theory on big integers
+//
+
+#ifndef BIGINT_BIG_INTEGER_MATH_H
+#define BIGINT_BIG_INTEGER_MATH_H
+
+#include "big_integer.h"
+#include <vector>
+
+//the greatest common divisor of |a| and |b|, gcd(0, 0) = 0
+big_integer gcd(big_integer const& a, big_integer const& b);
+//the least common multiple of |a| and |b|, zero when either of them is zero
+big_integer lcm(big_integer const& a, big_integer const& b);
+//g = gcd(a, b) = a * s + b * t with |s| <= |b| / 2g and |t| <= |a| / 2g, or s = sign(a) and t = 0 for b = 0
+big_integer gcdext(big_integer const& a, big_integer const& b, big_integer& s, big_integer& t);
+
+//base^e by left to right binary exponentiation, 0^0 = 1
+big_integer pow(big_integer const& base, unsigned long e);
+//base^e computed on digits, 0^0 = 1
+big_integer pow_ui(unsigned long base, unsigned long e);
+
+//floor(sqrt(x)) for x >= 0
+big_integer isqrt(big_integer const& x);
+//floor(sqrt(x)) for x >= 0, rem is set to x minus its square
+big_integer isqrt_rem(big_integer const& x, big_integer& rem);
+//the k-th root of x rounded towards zero for k >= 1, x may be negative for an odd k only
+big_integer iroot(big_integer const& x, unsigned int k);
+//whether x is the square of an integer, most other values are told apart by their residues modulo small numbers
+bool is_perfect_square(big_integer const& x);
+
+//the products below are split into balanced multiplications by binary splitting, the parts at the bottom
+//of the split may be computed by up to threads threads; n must fit in a digit
+//n!
+big_integer factorial(unsigned long n, unsigned int threads = 1);
+//n! / (k! (n - k)!), zero for k > n
+big_integer binomial(unsigned long n, unsigned long k, unsigned int threads = 1);
+//the product of the primes up to n
+big_integer primorial(unsigned long n, unsigned int threads = 1);
+
+//the products of adjacent pairs at each level of a binary tree over count positive values, with an odd one out
+//carried up as it is; a level keeps all its values one after another in a single digit buffer, and the products
+//of a level may be split between up to threads threads
+struct product_tree {
+    typedef big_integer::digit_t digit_t;
+
+    product_tree(big_integer const* xs, size_t count, unsigned int threads = 1);
+
+    size_t size() const;
+    //the product of all the values, one for none
+    big_integer root() const;
+
+private:
+    struct level {
+        std::vector <digit_t> digits;
+        //the i-th value starts at offsets[i] and has lengths[i] significant digits out of the reserved ones
+        std::vector <size_t> offsets;
+        std::vector <size_t> lengths;
+    };
+    std::vector <level> levels;
+
+    friend std::vector <big_integer> remainder_tree(big_integer const& x, product_tree const& tree,
+                                                    unsigned int threads);
+};
+
+//x mod xs[i] in [0, xs[i]) for each value of the tree, reduced from x mod the root down one level at a time;
+//the remainders of a level may be split between up to threads threads
+std::vector <big_integer> remainder_tree(big_integer const& x, product_tree const& tree, unsigned int threads = 1);
+
+#endif //BIGINT_BIG_INTEGER_MATH_H
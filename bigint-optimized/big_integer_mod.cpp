@@ -0,0 +1,347 @@
+//
+// Arithmetic modulo a fixed modulus
+//
+
+#include "big_integer_mod.h"
+#include "big_integer_math.h"
+#include "mpn.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+typedef big_integer::digit_t digit_t;
+
+const int BASE = std::numeric_limits <digit_t>::digits;
+
+//scratch space comes from the current digit_allocator as well
+typedef std::vector <digit_t, allocator_adaptor <digit_t>> scratch_vector;
+
+namespace {
+    bool test_bit(big_integer const& x, size_t i) {
+        return ((x.get_digit(i / BASE) >> (i % BASE)) & 1) != 0;
+    }
+
+    size_t digit_length(big_integer const& x) {
+        return (x.bit_length() + BASE - 1) / BASE;
+    }
+
+    //the lowest n digits of x
+    void to_digits(big_integer const& x, digit_t* r, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            r[i] = x.get_digit(i);
+        }
+    }
+
+    big_integer from_digits(digit_t const* a, size_t n) {
+        digit_vector d(n);
+        std::copy(a, a + n, d.mutable_data());
+        return big_integer(false, std::move(d));
+    }
+
+    //x mod m in [0, m)
+    big_integer reduced(big_integer const& x, big_integer const& m) {
+        big_integer r = x % m;
+        if (r < 0) {
+            r += m;
+        }
+        return r;
+    }
+
+    big_integer digit_power(size_t k) {
+        return big_integer(1) << static_cast <unsigned int> (k * BASE);
+    }
+
+    //the window sizes that minimize the number of multiplications for a given exponent length
+    size_t window_size(size_t bits) {
+        const size_t limits[] = {7, 25, 81, 241, 673};
+        size_t k = 1;
+        while (k < 6 && bits > limits[k - 1]) {
+            k++;
+        }
+        return k;
+    }
+
+    //x^exp from the odd powers x, x^3, ..., x^(2^k - 1): every window of up to k bits that ends in a one
+    //costs its squarings and a single multiplication; mul(r, a, b) sets r = a * b and is passed the same
+    //object for a and b to square
+    template <class T, class MulT>
+    T sliding_window_pow(T const& x, T const& one, big_integer const& exp, MulT mul) {
+        size_t bits = exp.bit_length();
+        if (bits == 0) {
+            return one;
+        }
+        size_t k = window_size(bits);
+        std::vector <T> odd(size_t(1) << (k - 1), x);
+        if (k > 1) {
+            T x2 = x;
+            mul(x2, x, x);
+            for (size_t i = 1; i < odd.size(); i++) {
+                mul(odd[i], odd[i - 1], x2);
+            }
+        }
+
+        T acc = one;
+        bool started = false;
+        size_t i = bits;
+        while (i > 0) {
+            if (!test_bit(exp, i - 1)) {
+                mul(acc, acc, acc);
+                i--;
+                continue;
+            }
+            size_t low = (i > k ? i - k : 0);
+            while (!test_bit(exp, low)) {
+                low++;
+            }
+            size_t window = 0;
+            for (size_t j = i; j > low; j--) {
+                window = (window << 1) | (test_bit(exp, j - 1) ? 1 : 0);
+                if (started) {
+                    mul(acc, acc, acc);
+                }
+            }
+            if (started) {
+                mul(acc, acc, odd[window >> 1]);
+            }
+            else {
+                acc = odd[window >> 1];
+                started = true;
+            }
+            i = low;
+        }
+        return acc;
+    }
+}
+
+barrett_reducer::barrett_reducer(big_integer const& m) : m(m) {
+    if (m <= 0) {
+        throw std::runtime_error("Modulus must be positive");
+    }
+    n = digit_length(m);
+    m_digits.resize(n + 1);
+    to_digits(m, m_digits.data(), n + 1);
+
+    //only m = B^(n-1) gives mu = B^(n+1), one short of it the estimate stays within three of the quotient
+    big_integer reciprocal = digit_power(2 * n) / m;
+    if (reciprocal == digit_power(n + 1)) {
+        reciprocal -= 1;
+    }
+    mu.resize(n + 1);
+    to_digits(reciprocal, mu.data(), n + 1);
+}
+
+big_integer const& barrett_reducer::modulus() const {
+    return m;
+}
+
+size_t barrett_reducer::reduce_itch() const {
+    return 6 * n + 3 + std::max(mpn::mul_itch(n + 1, n + 1), mpn::mullo_itch(n + 1));
+}
+
+size_t barrett_reducer::mul_itch() const {
+    return 2 * n + std::max({mpn::mul_itch(n, n), mpn::sqr_itch(n), reduce_itch()});
+}
+
+//q = floor(floor(x / B^(n-1)) * mu / B^(n+1)) is at most two short of the quotient, so x - qm is below 3m < B^(n+1)
+//and only the low n + 1 digits of qm are needed, which mullo_n gives; below thresholds.barrett_mul the columns
+//of the first product under n - 1, which add up to less than B^(n+1), are skipped as well, leaving q at most
+//three short, longer moduli take it whole from the fast multiplication; r may alias x
+void barrett_reducer::reduce_2n(digit_t* r, digit_t const* x, digit_t* t) const {
+    digit_t* q = t;
+    digit_t* qm = q + 2 * n + 2;
+    digit_t* scratch = qm + 2 * n + 1;
+    digit_t const* x1 = x + n - 1;
+    if (n >= big_integer::thresholds.barrett_mul) {
+        mpn::mul(q, x1, n + 1, mu.data(), n + 1, scratch);
+    }
+    else {
+        std::fill(q + n - 1, q + 2 * n + 2, 0);
+        for (size_t j = 0; j <= n; j++) {
+            size_t from = (j + 1 < n ? n - 1 - j : 0);
+            q[n + 1 + j] = mpn::addmul_1(q + from + j, x1 + from, n + 1 - from, mu[j]);
+        }
+    }
+    mpn::mullo_n(qm, q + n + 1, m_digits.data(), n + 1, scratch);
+    mpn::sub_n(qm, x, qm, n + 1);
+    while (qm[n] != 0 || mpn::cmp_n(qm, m_digits.data(), n) >= 0) {
+        qm[n] -= mpn::sub_n(qm, qm, m_digits.data(), n);
+    }
+    std::copy(qm, qm + n, r);
+}
+
+//the residue so far with the next digits of x below it is less than B^2n, so longer values are folded
+//from the top n digits at a time
+void barrett_reducer::reduce_span(digit_t* r, digit_t const* x, size_t len, digit_t* t) const {
+    digit_t* w = t;
+    t += 2 * n;
+    size_t pos = len - std::min(len, 2 * n);
+    std::fill(w, w + 2 * n, 0);
+    std::copy(x + pos, x + len, w);
+    reduce_2n(w, w, t);
+    while (pos > 0) {
+        size_t k = std::min(n, pos);
+        pos -= k;
+        std::copy_backward(w, w + n, w + k + n);
+        std::copy(x + pos, x + pos + k, w);
+        std::fill(w + k + n, w + 2 * n, 0);
+        reduce_2n(w, w, t);
+    }
+    std::copy(w, w + n, r);
+}
+
+void barrett_reducer::mul(digit_t* r, digit_t const* a, digit_t const* b, digit_t* t) const {
+    if (a == b) {
+        mpn::sqr(t, a, n, t + 2 * n);
+    }
+    else {
+        mpn::mul(t, a, n, b, n, t + 2 * n);
+    }
+    reduce_2n(r, t, t + 2 * n);
+}
+
+big_integer barrett_reducer::reduce(big_integer const& x) const {
+    big_integer res = x;
+    reduce(&res, 1);
+    return res;
+}
+
+//the digits of a negative value are negated in the scratch instead of taking a copy of its absolute value
+void barrett_reducer::reduce(big_integer* xs, size_t count) const {
+    scratch_vector t(reduce_itch());
+    scratch_vector digits;
+    scratch_vector r(n);
+    for (size_t i = 0; i < count; i++) {
+        big_integer& x = xs[i];
+        bool negative = x < 0;
+        if (!negative && x < m) {
+            continue;
+        }
+        //-1 keeps no digits at all, the sign digit makes room for the magnitude
+        size_t len = x.length() + (negative ? 1 : 0);
+        digits.resize(len);
+        to_digits(x, digits.data(), len);
+        if (negative) {
+            digit_t one = 1;
+            std::transform(digits.begin(), digits.end(), digits.begin(), [](digit_t d) { return ~d; });
+            mpn::add_to(digits.data(), len, &one, 1);
+        }
+        reduce_span(r.data(), digits.data(), len, t.data());
+        x = from_digits(r.data(), n);
+        if (negative && !x.is_zero()) {
+            x = m - x;
+        }
+    }
+}
+
+big_integer barrett_reducer::pow(big_integer const& base, big_integer const& exp) const {
+    if (exp < 0) {
+        throw std::runtime_error("Negative exponent");
+    }
+    scratch_vector t(mul_itch());
+    auto barrett_mul = [&](scratch_vector& r, scratch_vector const& a, scratch_vector const& b) {
+        mul(r.data(), a.data(), b.data(), t.data());
+    };
+
+    scratch_vector x(n);
+    to_digits(reduce(base), x.data(), n);
+    scratch_vector one(n);
+    to_digits(reduce(1), one.data(), n);
+    scratch_vector res = sliding_window_pow(x, one, exp, barrett_mul);
+    return from_digits(res.data(), n);
+}
+
+montgomery_context::montgomery_context(big_integer const& m) : m(m) {
+    if (m <= 0 || !test_bit(m, 0)) {
+        throw std::runtime_error("Modulus must be odd and positive");
+    }
+    n = digit_length(m);
+    m_digits.resize(n);
+    to_digits(m, m_digits.data(), n);
+
+    //Newton's iteration for the inverse modulo B doubles the number of correct low bits, an odd digit
+    //is its own inverse modulo 8
+    digit_t inv = m_digits[0];
+    for (int bits = 3; bits < BASE; bits *= 2) {
+        inv *= 2 - m_digits[0] * inv;
+    }
+    m_inv = 0 - inv;
+
+    r2.resize(n);
+    to_digits(digit_power(2 * n) % m, r2.data(), n);
+}
+
+big_integer const& montgomery_context::modulus() const {
+    return m;
+}
+
+size_t montgomery_context::mul_itch() const {
+    return 2 * n + 1 + std::max(mpn::mul_itch(n, n), mpn::sqr_itch(n));
+}
+
+//t + u * m for all n digits u together is below 2mR, so the sum fits in 2n + 1 digits
+void montgomery_context::redc(digit_t* r, digit_t* t) const {
+    t[2 * n] = 0;
+    for (size_t i = 0; i < n; i++) {
+        digit_t u = t[i] * m_inv;
+        digit_t carry = mpn::addmul_1(t + i, m_digits.data(), n, u);
+        mpn::add_to(t + i + n, n + 1 - i, &carry, 1);
+    }
+    digit_t* hi = t + n;
+    if (hi[n] != 0 || mpn::cmp_n(hi, m_digits.data(), n) >= 0) {
+        mpn::sub_n(r, hi, m_digits.data(), n);
+    }
+    else {
+        std::copy(hi, hi + n, r);
+    }
+}
+
+void montgomery_context::mul(digit_t* r, digit_t const* a, digit_t const* b, digit_t* t) const {
+    if (a == b) {
+        mpn::sqr(t, a, n, t + 2 * n + 1);
+    }
+    else {
+        mpn::mul(t, a, n, b, n, t + 2 * n + 1);
+    }
+    redc(r, t);
+}
+
+big_integer montgomery_context::pow(big_integer const& base, big_integer const& exp) const {
+    if (exp < 0) {
+        throw std::runtime_error("Negative exponent");
+    }
+    scratch_vector t(mul_itch());
+    auto mont_mul = [&](scratch_vector& r, scratch_vector const& a, scratch_vector const& b) {
+        mul(r.data(), a.data(), b.data(), t.data());
+    };
+
+    scratch_vector x(n);
+    to_digits(reduced(base, m), x.data(), n);
+    mul(x.data(), x.data(), r2.data(), t.data());
+    scratch_vector one(n);
+    one[0] = 1;
+    mul(one.data(), one.data(), r2.data(), t.data());
+
+    scratch_vector res = sliding_window_pow(x, one, exp, mont_mul);
+    std::fill(t.begin(), t.end(), 0);
+    std::copy(res.begin(), res.end(), t.begin());
+    redc(res.data(), t.data());
+    return from_digits(res.data(), n);
+}
+
+big_integer invert(big_integer const& a, big_integer const& m) {
+    if (m <= 0) {
+        throw std::runtime_error("Modulus must be positive");
+    }
+    big_integer s, t;
+    if (gcdext(a, m, s, t) != 1) {
+        throw std::runtime_error("Not invertible");
+    }
+    return reduced(s, m);
+}
+
+big_integer powmod(big_integer const& base, big_integer const& exp, big_integer const& m) {
+    if (m > 0 && test_bit(m, 0)) {
+        return montgomery_context(m).pow(base, exp);
+    }
+    return barrett_reducer(m).pow(base, exp);
+}
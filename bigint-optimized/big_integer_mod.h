@@ -0,0 +1,76 @@
+//
+// Arithmetic modulo a fixed modulus
+//
+
+#ifndef BIGINT_BIG_INTEGER_MOD_H
+#define BIGINT_BIG_INTEGER_MOD_H
+
+#include "big_integer.h"
+#include <vector>
+
+//reduces by a fixed modulus m > 0 of n digits with two multiplications by the precomputed mu = floor(B^2n / m)
+//in place of a division, B being the digit base; values longer than 2n digits are folded n digits at a time,
+//moduli of thresholds.barrett_mul digits and more take both products whole from the fast multiplication
+struct barrett_reducer {
+    typedef big_integer::digit_t digit_t;
+
+    explicit barrett_reducer(big_integer const& m);
+
+    big_integer const& modulus() const;
+    //x mod m in [0, m)
+    big_integer reduce(big_integer const& x) const;
+    //replaces each of xs[0, count) by its residue, the scratch space is allocated once for all of them
+    void reduce(big_integer* xs, size_t count) const;
+    //base^exp mod m in [0, m), exp >= 0
+    big_integer pow(big_integer const& base, big_integer const& exp) const;
+
+private:
+    //r[0, n) = x[0, 2n) mod m, t has reduce_itch() digits
+    void reduce_2n(digit_t* r, digit_t const* x, digit_t* t) const;
+    //r[0, n) = x[0, len) mod m, t has reduce_itch() digits
+    void reduce_span(digit_t* r, digit_t const* x, size_t len, digit_t* t) const;
+    size_t reduce_itch() const;
+    //r[0, n) = a * b mod m for a, b in [0, m), t has mul_itch() digits
+    void mul(digit_t* r, digit_t const* a, digit_t const* b, digit_t* t) const;
+    size_t mul_itch() const;
+
+    big_integer m;
+    size_t n;
+    //with a zero digit on top
+    std::vector <digit_t> m_digits;
+    std::vector <digit_t> mu;
+};
+
+//multiplies in the Montgomery form aR mod m, R = B^n, for an odd modulus m > 0 of n digits;
+//m' = -m^-1 mod B and R^2 mod m are computed once, the context may serve any number of exponentiations
+struct montgomery_context {
+    typedef big_integer::digit_t digit_t;
+
+    explicit montgomery_context(big_integer const& m);
+
+    big_integer const& modulus() const;
+    //base^exp mod m in [0, m), exp >= 0
+    big_integer pow(big_integer const& base, big_integer const& exp) const;
+
+private:
+    //r[0, n) = a * b / R mod m for a, b in [0, m), t has mul_itch() digits
+    void mul(digit_t* r, digit_t const* a, digit_t const* b, digit_t* t) const;
+    //r[0, n) = t[0, 2n) / R mod m for t < mR, t[0, 2n] is overwritten
+    void redc(digit_t* r, digit_t* t) const;
+    size_t mul_itch() const;
+
+    big_integer m;
+    size_t n;
+    digit_t m_inv;
+    std::vector <digit_t> m_digits;
+    std::vector <digit_t> r2;
+};
+
+//a^-1 mod m in [0, m) for m > 0, throws when a and m are not coprime
+big_integer invert(big_integer const& a, big_integer const& m);
+
+//base^exp mod m in [0, m) for exp >= 0 and m > 0, by Montgomery multiplication for an odd modulus
+//and Barrett reduction for an even one
+big_integer powmod(big_integer const& base, big_integer const& exp, big_integer const& m);
+
+#endif //BIGINT_BIG_INTEGER_MOD_H
@@ -1,11 +1,17 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include <utility>
 #include "gtest/gtest.h"
 
 #include "big_integer.h"
+#include "big_integer_expr.h"
+#include "big_integer_math.h"
+#include "big_integer_mod.h"
+#include "mpn.h"
 
 TEST(correctness, two_plus_two)
 {
@@ -736,3 +742,908 @@ TEST(correctness, div_randomized)
         EXPECT_LT(residue, divisor);
     }
 }
+
+TEST(correctness, mul_karatsuba)
+{
+    size_t const threshold = big_integer::thresholds.karatsuba_mul;
+    for (size_t itn = 0; itn != number_of_iterations; ++itn)
+    {
+        big_integer a = rand_big(200 + rand() % 200);
+        big_integer b = -rand_big(200 + rand() % 200);
+        big_integer c = rand_big(40);
+
+        big_integer::thresholds.karatsuba_mul = std::numeric_limits<size_t>::max();
+        big_integer ab = a * b;
+        big_integer ac = a * c;
+        big_integer::thresholds.karatsuba_mul = threshold;
+
+        EXPECT_EQ(a * b, ab);
+        EXPECT_EQ(b * a, ab);
+        EXPECT_EQ(a * c, ac);
+        EXPECT_EQ(c * a, ac);
+    }
+}
+
+TEST(correctness, mul_karatsuba_min_threshold)
+{
+    size_t const threshold = big_integer::thresholds.karatsuba_mul;
+    big_integer a = rand_big(100);
+    big_integer b = rand_big(70);
+    big_integer ab = a * b;
+
+    big_integer::thresholds.karatsuba_mul = 0;
+    EXPECT_EQ(a * b, ab);
+    EXPECT_EQ(ab / a, b);
+    big_integer::thresholds.karatsuba_mul = threshold;
+}
+
+TEST(correctness, mul_merge_randomized_toom)
+{
+    for (unsigned itn = 0; itn != 2; ++itn)
+    {
+        std::vector<big_integer> x;
+        for (size_t i = 0; i != 64; ++i)
+            x.push_back(rand_big(60));
+
+        big_integer a = merge_all(x);
+        big_integer b = merge_all(x);
+
+        EXPECT_TRUE(a == b);
+    }
+}
+
+TEST(correctness, mul_toom_thresholds)
+{
+    big_integer::algorithm_thresholds const thresholds = big_integer::thresholds;
+    big_integer a = rand_big(1000);
+    big_integer b = -rand_big(900);
+    big_integer c = rand_big(500);
+
+    big_integer::thresholds.toom3_mul = big_integer::thresholds.toom4_mul = std::numeric_limits<size_t>::max();
+    big_integer ab = a * b;
+    big_integer ac = a * c;
+    big_integer bc = b * c;
+
+    big_integer::thresholds.toom3_mul = 40;
+    EXPECT_EQ(a * b, ab);
+    EXPECT_EQ(a * c, ac);
+    big_integer::thresholds.toom4_mul = 40;
+    EXPECT_EQ(a * b, ab);
+    EXPECT_EQ(a * c, ac);
+    big_integer::thresholds.toom3_mul = 0;
+    big_integer::thresholds.toom4_mul = 0;
+    EXPECT_EQ(a * b, ab);
+    EXPECT_EQ(b * c, bc);
+    big_integer::thresholds = thresholds;
+}
+
+TEST(correctness, mul_ntt)
+{
+    big_integer::algorithm_thresholds const thresholds = big_integer::thresholds;
+    big_integer a = rand_big(3000);
+    big_integer b = -rand_big(2500);
+    big_integer c = rand_big(300);
+
+    big_integer::thresholds.ntt_mul = std::numeric_limits<size_t>::max();
+    big_integer ab = a * b;
+    big_integer ac = a * c;
+    big_integer bb = b * b;
+
+    big_integer::thresholds.ntt_mul = 100;
+    EXPECT_EQ(a * b, ab);
+    EXPECT_EQ(c * a, ac);
+    EXPECT_EQ(b * b, bb);
+    EXPECT_EQ(b * big_integer(b), bb);
+    big_integer::thresholds = thresholds;
+}
+
+TEST(correctness, sqr_ntt_max_digits)
+{
+    unsigned const bits = 32 * 50000;
+    big_integer x = (big_integer(1) << bits) - 1;
+    big_integer y = x;
+    big_integer expected = (big_integer(1) << (2 * bits)) - (big_integer(1) << (bits + 1)) + 1;
+
+    EXPECT_EQ(x * x, expected);
+    EXPECT_EQ(x * y, expected);
+}
+
+TEST(correctness, square)
+{
+    EXPECT_EQ(big_integer(0).square(), 0);
+    EXPECT_EQ(big_integer(-7).square(), 49);
+    EXPECT_EQ(big_integer(std::numeric_limits<int>::min()).square(), big_integer("4611686018427387904"));
+
+    big_integer a("-1234567890123456789012345678901234567890");
+    EXPECT_EQ(a * a, big_integer("1524157875323883675049535156256668194500533455762536198787501905199875019052100"));
+    EXPECT_EQ(a.square(), a * a);
+}
+
+TEST(correctness, square_shrunk_copy)
+{
+    big_integer a = (big_integer(1) << 500) + 12345;
+    big_integer b = a;
+    b >>= 100000;
+    EXPECT_EQ(b, 0);
+    EXPECT_EQ(a * b, 0);
+    EXPECT_EQ(b * a, 0);
+
+    big_integer c = -(big_integer(1) << 500) - 12345;
+    big_integer d = c;
+    d >>= 100000;
+    EXPECT_EQ(d, -1);
+    EXPECT_EQ(c * d, -c);
+    EXPECT_EQ(d * c, -c);
+}
+
+TEST(correctness, square_tiers)
+{
+    big_integer::algorithm_thresholds const thresholds = big_integer::thresholds;
+    std::vector<big_integer> x;
+    std::vector<big_integer> expected;
+    for (size_t size : {10, 100, 300, 1000, 2500})
+    {
+        x.push_back(size % 20 ? -rand_big(size) : rand_big(size));
+        expected.push_back(x.back() * (x.back() + 0));
+    }
+
+    for (size_t threshold : {4, 16, 40, 100})
+    {
+        big_integer::thresholds.karatsuba_sqr = threshold;
+        big_integer::thresholds.toom3_sqr = 2 * threshold;
+        big_integer::thresholds.toom4_sqr = 4 * threshold;
+        big_integer::thresholds.ntt_sqr = 16 * threshold;
+        for (size_t i = 0; i != x.size(); ++i)
+        {
+            EXPECT_EQ(x[i].square(), expected[i]);
+            EXPECT_EQ(x[i] * x[i], expected[i]);
+        }
+    }
+    big_integer::thresholds = thresholds;
+}
+
+TEST(correctness, divmod)
+{
+    typedef std::pair<big_integer, big_integer> qr;
+    EXPECT_EQ(big_integer::divmod(7, 2), qr(3, 1));
+    EXPECT_EQ(big_integer::divmod(-7, 2), qr(-3, -1));
+    EXPECT_EQ(big_integer::divmod(7, -2), qr(-3, 1));
+    EXPECT_EQ(big_integer::divmod(-7, -2), qr(3, -1));
+    EXPECT_EQ(big_integer::divmod(5, 7), qr(0, 5));
+    EXPECT_EQ(big_integer::divmod(-6, 3), qr(-2, 0));
+    EXPECT_THROW(big_integer::divmod(1, 0), std::runtime_error);
+}
+
+TEST(correctness, divmod_burnikel_ziegler)
+{
+    size_t const threshold = big_integer::thresholds.burnikel_ziegler_div;
+    for (size_t itn = 0; itn != number_of_iterations; ++itn)
+    {
+        big_integer divident = rand_big(700 + rand() % 700);
+        big_integer divisor = (itn % 2 ? -rand_big(100 + rand() % 600) : rand_big(100 + rand() % 600));
+
+        big_integer::thresholds.burnikel_ziegler_div = std::numeric_limits<size_t>::max();
+        std::pair<big_integer, big_integer> expected = big_integer::divmod(divident, divisor);
+        big_integer::thresholds.burnikel_ziegler_div = 8;
+        std::pair<big_integer, big_integer> qr = big_integer::divmod(divident, divisor);
+        big_integer::thresholds.burnikel_ziegler_div = threshold;
+
+        EXPECT_EQ(qr, expected);
+        EXPECT_EQ(qr.first * divisor + qr.second, divident);
+        EXPECT_GE(qr.second, 0);
+        EXPECT_LT(qr.second.abs(), divisor.abs());
+    }
+}
+
+TEST(correctness, divmod_burnikel_ziegler_all_ones)
+{
+    big_integer b = (big_integer(1) << (32 * 300)) - 1;
+    big_integer q = (big_integer(1) << (32 * 450)) - 1;
+    big_integer a = b * q + (b - 1);
+
+    EXPECT_EQ(big_integer::divmod(a, b), std::make_pair(q, b - 1));
+    EXPECT_EQ(big_integer::divmod(a - b + 1, b), std::make_pair(q, big_integer(0)));
+    EXPECT_EQ(big_integer::divmod(a + 1, b), std::make_pair(q + 1, big_integer(0)));
+}
+
+TEST(correctness, divmod_to)
+{
+    big_integer a("-1000000000000000000000000000000000000000000000000000000000007");
+    big_integer b("1000000000000000000000000000000");
+    big_integer q = 5;
+    big_integer r = 7;
+
+    big_integer::divmod_to(q, r, a, b);
+    EXPECT_EQ(q, big_integer("-1000000000000000000000000000000"));
+    EXPECT_EQ(r, -7);
+
+    big_integer::divmod_to(a, r, a, 3);
+    EXPECT_EQ(a, big_integer("-333333333333333333333333333333333333333333333333333333333335"));
+    EXPECT_EQ(r, -2);
+
+    big_integer::divmod_to(q, b, b, a);
+    EXPECT_EQ(q, 0);
+    EXPECT_EQ(b, big_integer("1000000000000000000000000000000"));
+}
+
+TEST(correctness, mod_assignment)
+{
+    big_integer a = rand_big(40);
+    big_integer b = rand_big(15);
+    big_integer q = a / b;
+    big_integer r = a % b;
+
+    EXPECT_EQ(q * b + r, a);
+    a %= b;
+    EXPECT_EQ(a, r);
+    a %= a;
+    EXPECT_EQ(a, 0);
+}
+
+TEST(correctness, to_string_divide_and_conquer)
+{
+    big_integer::algorithm_thresholds saved = big_integer::thresholds;
+    std::string str = "-1";
+    for (size_t i = 0; i < 3000; i++)
+    {
+        str.push_back(char('0' + (i * 7 + i / 13) % 10));
+    }
+    str += "000000000000000000000000000000000000000000000000000000000000001";
+    for (size_t threshold : {2, 5, 30})
+    {
+        big_integer::thresholds.dc_to_string = threshold;
+        EXPECT_EQ(to_string(big_integer(str)), str);
+        EXPECT_EQ(to_string(big_integer(str) - 1), str.substr(0, str.size() - 1) + "2");
+    }
+    big_integer::thresholds = saved;
+
+    big_integer p10 = 1;
+    for (size_t i = 0; i < 500; i++)
+    {
+        p10 *= 10;
+    }
+    EXPECT_EQ(to_string(p10), "1" + std::string(500, '0'));
+    EXPECT_EQ(to_string(p10 - 1), std::string(500, '9'));
+}
+
+TEST(correctness, to_string_base)
+{
+    EXPECT_EQ(to_string(big_integer(255), 16), "ff");
+    EXPECT_EQ(to_string(big_integer(-255), 2), "-11111111");
+    EXPECT_EQ(to_string(big_integer(0), 36), "0");
+    EXPECT_EQ(to_string(big_integer("4294967296"), 8), "40000000000");
+    EXPECT_EQ(to_string(big_integer("1295"), 36), "zz");
+    EXPECT_THROW(to_string(big_integer(1), 37), std::runtime_error);
+
+    big_integer::algorithm_thresholds saved = big_integer::thresholds;
+    big_integer::thresholds.dc_to_string = 2;
+    for (unsigned int base = 2; base <= 36; base++)
+    {
+        big_integer a = rand_big(60);
+        std::string str = to_string(a, base);
+        big_integer b = 0;
+        for (size_t i = (str[0] == '-'); i < str.size(); i++)
+        {
+            int d = (str[i] <= '9' ? str[i] - '0' : str[i] - 'a' + 10);
+            EXPECT_LT(d, int(base));
+            b = b * int(base) + d;
+        }
+        EXPECT_EQ(str[0] == '-' ? -b : b, a);
+    }
+    big_integer::thresholds = saved;
+}
+
+TEST(correctness, string_conv_divide_and_conquer)
+{
+    big_integer::algorithm_thresholds saved = big_integer::thresholds;
+    std::string str = "-";
+    for (size_t i = 0; i < 5000; i++)
+    {
+        str.push_back(char('0' + (i * 7 + i / 11) % 10));
+    }
+    big_integer expected = 0;
+    for (size_t i = 1; i < str.size(); i++)
+    {
+        expected = expected * 10 - (str[i] - '0');
+    }
+    for (size_t threshold : {2, 7, 30})
+    {
+        big_integer::thresholds.dc_from_string = threshold;
+        EXPECT_EQ(big_integer(str), expected);
+        EXPECT_EQ(big_integer(str.data() + 1, str.data() + 4001), -(expected / big_integer("1" + std::string(1000, '0'))));
+    }
+    big_integer::thresholds = saved;
+    EXPECT_THROW(big_integer("12a"), std::runtime_error);
+}
+
+TEST(correctness, string_conv_base)
+{
+    EXPECT_EQ(big_integer("ff", 16), 255);
+    EXPECT_EQ(big_integer("-FfFfFfFf", 16), big_integer("-4294967295"));
+    EXPECT_EQ(big_integer("100000000000000000000000000000000", 2), big_integer("4294967296"));
+    EXPECT_EQ(big_integer("zz", 36), 1295);
+    EXPECT_EQ(big_integer("0", 7), 0);
+    EXPECT_THROW(big_integer("12", 2), std::runtime_error);
+    EXPECT_THROW(big_integer("1", 1), std::runtime_error);
+
+    for (unsigned int base = 2; base <= 36; base++)
+    {
+        big_integer a = rand_big(200);
+        std::string str = to_string(-a, base);
+        EXPECT_EQ(big_integer(str, base), -a);
+        EXPECT_EQ(big_integer(str.data() + 1, str.data() + str.size(), base), a);
+    }
+}
+
+TEST(correctness, string_conv_threads)
+{
+    //every thread converts values of its own, the cached powers of the bases are all they have in common
+    std::vector<std::string> strs;
+    for (int i = 0; i < 8; i++)
+    {
+        strs.push_back(to_string(rand_big(400 + 50 * i)));
+    }
+    std::vector<int> ok(4, 0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < ok.size(); t++)
+    {
+        threads.emplace_back([&strs, &ok, t]()
+        {
+            bool all = true;
+            for (int round = 0; round < 20; round++)
+            {
+                for (std::string const& str : strs)
+                {
+                    big_integer a(str);
+                    all = all && to_string(a) == str;
+                    all = all && big_integer(to_string(a, 7), 7) == a;
+                }
+            }
+            ok[t] = all;
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    for (int res : ok)
+    {
+        EXPECT_TRUE(res);
+    }
+}
+
+TEST(correctness, add_sub_in_place)
+{
+    big_integer a = rand_big(30);
+    big_integer b = -rand_big(45);
+    big_integer c = a;
+    big_integer sum = a + b;
+    big_integer dif = a - b;
+
+    c += b;
+    EXPECT_EQ(c, sum);
+    EXPECT_EQ(a, sum - b);
+    c -= b;
+    c -= b;
+    EXPECT_EQ(c, dif);
+    c = dif;
+    c += c;
+    EXPECT_EQ(c, dif + dif);
+    c -= c;
+    EXPECT_EQ(c, 0);
+    c -= 1;
+    EXPECT_EQ(c, -1);
+    c += big_integer("18446744073709551616");
+    EXPECT_EQ(c, big_integer("18446744073709551615"));
+    c += 1;
+    c -= big_integer("18446744073709551616");
+    EXPECT_EQ(c, 0);
+}
+
+TEST(correctness, mul_short_in_place)
+{
+    big_integer a = -rand_big(20);
+    big_integer b = a;
+    for (int d : {3, -7, 1, -1, 65536, 2147483647, -2147483647 - 1})
+    {
+        big_integer expected = a * big_integer(std::to_string(d));
+        b = a;
+        b *= d;
+        EXPECT_EQ(b, expected);
+    }
+    big_integer minus_base = -(big_integer(1) << std::numeric_limits<big_integer::digit_t>::digits);
+    b = a;
+    b *= minus_base;
+    EXPECT_EQ(b, a * minus_base);
+    b = 2147483647;
+    b *= b;
+    EXPECT_EQ(b, big_integer("4611686014132420609"));
+    b = -1;
+    b *= 0;
+    EXPECT_EQ(b, 0);
+}
+
+TEST(correctness, shift_in_place)
+{
+    big_integer a("-817481237412378461284761285761238721364871236412387461238476");
+    for (unsigned int shift : {0, 1, 31, 32, 33, 64, 100})
+    {
+        big_integer p = 1;
+        for (unsigned int i = 0; i < shift; i++)
+        {
+            p *= 2;
+        }
+        big_integer b = a;
+        b <<= shift;
+        EXPECT_EQ(b, a * p);
+        b >>= shift;
+        EXPECT_EQ(b, a);
+        EXPECT_EQ(a >> shift, (a - p + 1) / p);
+        EXPECT_EQ(-a >> shift, -a / p);
+    }
+    big_integer c = (big_integer(1) << 31) + (big_integer(1) << 30);
+    EXPECT_EQ(c << 1, big_integer("6442450944"));
+    EXPECT_EQ(big_integer(-5) >> 1000, -1);
+    EXPECT_EQ(big_integer(5) >> 1000, 0);
+}
+
+TEST(correctness, move)
+{
+    big_integer a = rand_big(20);
+    big_integer copy = a;
+    big_integer b = std::move(a);
+    EXPECT_EQ(b, copy);
+    EXPECT_EQ(a, 0);
+    a += 5;
+    EXPECT_EQ(a, 5);
+
+    big_integer c = -copy;
+    c = std::move(b);
+    EXPECT_EQ(c, copy);
+    b = 7;
+    EXPECT_EQ(b * c, copy * 7);
+    EXPECT_TRUE(std::is_nothrow_move_constructible<big_integer>::value);
+    EXPECT_TRUE(std::is_nothrow_move_assignable<big_integer>::value);
+}
+
+TEST(correctness, rvalue_operators)
+{
+    big_integer a = rand_big(20);
+    big_integer b = -rand_big(25);
+    big_integer c = rand_big(10);
+
+    EXPECT_EQ(a * b + c, big_integer(a * b) + c);
+    EXPECT_EQ(c + a * b, c + big_integer(a * b));
+    EXPECT_EQ(a * b - c, big_integer(a * b) - c);
+    EXPECT_EQ(c - a * b, c - big_integer(a * b));
+    EXPECT_EQ(a * c - b * c, big_integer(a * c) - big_integer(b * c));
+    EXPECT_EQ((a + b) << 40, big_integer(a + b) << 40);
+    EXPECT_EQ((a - b) >> 40, big_integer(a - b) >> 40);
+
+    big_integer d = a;
+    EXPECT_EQ(d - std::move(d), 0);
+    d = a;
+    EXPECT_EQ(d + std::move(d), a + a);
+}
+
+TEST(correctness, sum_of_products)
+{
+    using big_integer_expr::lazy;
+    for (size_t len : {1, 3, 20, 100})
+    {
+        big_integer a = rand_big(len);
+        big_integer b = -rand_big(len + 2);
+        big_integer c = rand_big(len / 2 + 1);
+        big_integer d = -rand_big(len * 2);
+        big_integer e = rand_big(len * 3);
+
+        big_integer r = lazy(a) * b + lazy(c) * d - e;
+        EXPECT_EQ(r, a * b + c * d - e);
+        r = e - lazy(a) * a - lazy(d) * d;
+        EXPECT_EQ(r, e - a * a - d * d);
+        r = -(lazy(b) * c) + lazy(a);
+        EXPECT_EQ(r, a - b * c);
+        r = lazy(a) * b - lazy(a) * b;
+        EXPECT_EQ(r, 0);
+        r = lazy(a) * 0 - lazy(b) * -1 + big_integer(-1);
+        EXPECT_EQ(r, b - 1);
+        r = (c + d) - lazy(a) * b + (c - d);
+        EXPECT_EQ(r, c + c - a * b);
+        r = lazy(d) * d - lazy(d) * d - 1;
+        EXPECT_EQ(r, -1);
+    }
+}
+
+TEST(correctness, shared_digits)
+{
+    big_integer a = rand_big(30);
+    big_integer saved = a;
+    big_integer b = a;
+    b >>= 500;
+    EXPECT_EQ(a, saved);
+    EXPECT_EQ(b, saved >> 500);
+
+    big_integer c = a;
+    c += 1;
+    EXPECT_EQ(a, saved);
+    EXPECT_EQ(c - 1, a);
+
+    big_integer d = c;
+    d <<= 3000;
+    EXPECT_EQ(c - 1, saved);
+    EXPECT_EQ(d >> 3000, c);
+}
+
+TEST(correctness, small_values)
+{
+    EXPECT_LE(sizeof(big_integer), 32u);
+
+    big_integer a = (big_integer(1) << 127) - 1;
+    big_integer b = a;
+    b += 1;
+    EXPECT_EQ(b, big_integer(1) << 127);
+    EXPECT_EQ(b - 1, a);
+    EXPECT_EQ(-a - 1, -b);
+
+    big_integer c = b * b;
+    EXPECT_EQ(c, big_integer(1) << 254);
+    EXPECT_EQ(c / b, b);
+    c -= c;
+    EXPECT_EQ(c, 0);
+    c = -a;
+    EXPECT_EQ(c + a, 0);
+
+    std::vector<big_integer> v;
+    for (int i = 0; i < 100; i++)
+    {
+        v.push_back((big_integer(i) << (2 * i)) - i);
+    }
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(v[i], (big_integer(i) << (2 * i)) - i);
+    }
+}
+
+TEST(correctness, digit_allocators)
+{
+    big_integer a = rand_big(300);
+    big_integer b = -rand_big(200);
+    big_integer expected = a * b + a / b - (a << 1000);
+
+    {
+        digit_allocator::scope pool(pool_allocator::instance());
+        for (int i = 0; i < 3; i++)
+        {
+            EXPECT_EQ(a * b + a / b - (a << 1000), expected);
+        }
+        EXPECT_EQ(to_string(big_integer(to_string(a))), to_string(a));
+    }
+
+    arena_allocator arena(1 << 10);
+    big_integer in_arena;
+    {
+        digit_allocator::scope use(arena);
+        in_arena = a * b + a / b - (a << 1000);
+        big_integer copy = in_arena;
+        EXPECT_EQ(copy, expected);
+    }
+    big_integer kept = in_arena;
+    in_arena = 0;
+    arena.release();
+    EXPECT_EQ(kept, expected);
+}
+
+namespace
+{
+    big_integer span_value(std::vector<mpn::digit_t> const& d)
+    {
+        digit_vector v(d.size() + 1);
+        std::copy(d.begin(), d.end(), v.mutable_data());
+        return big_integer(false, v);
+    }
+}
+
+TEST(correctness, mpn_spans)
+{
+    typedef mpn::digit_t digit_t;
+    size_t n = 300;
+    std::vector<digit_t> scratch(std::max({mpn::mul_itch(n, n), mpn::sqr_itch(n), mpn::divrem_itch(n, n)}));
+    std::vector<digit_t> a(n);
+    for (digit_t& d : a)
+        d = (static_cast<digit_t>(rand()) << 16) ^ rand();
+
+    std::vector<digit_t> sq(2 * n);
+    mpn::sqr(sq.data(), a.data(), n, scratch.data());
+    EXPECT_EQ(span_value(sq), span_value(a) * span_value(a));
+
+    for (size_t m : {1, 2, 7, 40, 150, 300})
+    {
+        std::vector<digit_t> b(m);
+        for (digit_t& d : b)
+            d = (static_cast<digit_t>(rand()) << 16) ^ rand();
+        b[m - 1] |= 1;
+
+        std::vector<digit_t> mul(n + m);
+        mpn::mul(mul.data(), a.data(), n, b.data(), m, scratch.data());
+        EXPECT_EQ(span_value(mul), span_value(a) * span_value(b));
+
+        std::vector<digit_t> q(n - m + 1), r(m);
+        mpn::divrem(q.data(), r.data(), a.data(), n, b.data(), m, scratch.data());
+        EXPECT_EQ(span_value(q), span_value(a) / span_value(b));
+        EXPECT_EQ(span_value(r), span_value(a) % span_value(b));
+
+        std::vector<digit_t> low_a(a.begin(), a.begin() + m);
+        std::vector<digit_t> low(m);
+        std::vector<digit_t> low_scratch(mpn::mullo_itch(m) + 1);
+        mpn::mullo_n(low.data(), low_a.data(), b.data(), m, low_scratch.data());
+        big_integer modulus = big_integer(1) << static_cast<unsigned int>(m * std::numeric_limits<digit_t>::digits);
+        EXPECT_EQ(span_value(low), span_value(low_a) * span_value(b) % modulus);
+    }
+}
+
+namespace
+{
+    big_integer naive_powmod(big_integer base, big_integer exp, big_integer const& m)
+    {
+        big_integer res = 1 % m;
+        base %= m;
+        while (exp > 0)
+        {
+            if ((exp & 1) != 0)
+                res = res * base % m;
+            base = base * base % m;
+            exp >>= 1;
+        }
+        return res < 0 ? res + m : res;
+    }
+}
+
+TEST(correctness, powmod)
+{
+    big_integer p("170141183460469231731687303715884105727"); // 2^127 - 1
+    EXPECT_EQ(powmod(3, p - 1, p), 1);
+    EXPECT_EQ(powmod(-2, 3, 7), 6);
+    EXPECT_EQ(powmod(5, 0, 7), 1);
+    EXPECT_EQ(powmod(5, 0, 1), 0);
+    EXPECT_EQ(powmod(2, 100, big_integer(1) << 64), 0);
+    EXPECT_THROW(powmod(2, -1, 7), std::runtime_error);
+    EXPECT_THROW(powmod(2, 1, 0), std::runtime_error);
+
+    big_integer odd = (big_integer(1) << 1000) + 297;
+    big_integer even = (big_integer(1) << 999) * 3 + 4;
+    big_integer base = (big_integer(1) << 1500) / 7;
+    big_integer exp = (big_integer(1) << 300) / 11;
+    EXPECT_EQ(powmod(base, exp, odd), naive_powmod(base, exp, odd));
+    EXPECT_EQ(powmod(base, exp, even), naive_powmod(base, exp, even));
+    EXPECT_EQ(powmod(-base, exp + 1, even), naive_powmod(-base, exp + 1, even));
+
+    montgomery_context ctx(odd);
+    for (int e = 1; e < 40; e += 3)
+        EXPECT_EQ(ctx.pow(base + e, e * e), naive_powmod(base + e, e * e, odd));
+}
+
+TEST(correctness, barrett_reducer)
+{
+    big_integer::algorithm_thresholds saved = big_integer::thresholds;
+    for (size_t limit : {saved.barrett_mul, size_t(1)})
+    {
+        big_integer::thresholds.barrett_mul = limit;
+        for (big_integer const& m : {big_integer(1), big_integer(10), big_integer(1) << 32, big_integer(1) << 64,
+                                     (big_integer(1) << 700) - 1, (big_integer(3) << 900) + 12345})
+        {
+            barrett_reducer reducer(m);
+            std::vector<big_integer> xs = {0, 1, -1, m - 1, m, -m, m * m - 1, m * m * m + 7, -(m * m * m * m) - 3,
+                                           (big_integer(1) << 5000) + 99, big_integer(-123456789)};
+            std::vector<big_integer> expected;
+            for (big_integer const& x : xs)
+                expected.push_back(x % m < 0 ? x % m + m : x % m);
+
+            EXPECT_EQ(reducer.reduce(xs[6]), expected[6]);
+            reducer.reduce(xs.data(), xs.size());
+            EXPECT_EQ(xs, expected);
+            EXPECT_EQ(reducer.pow(-7, 1000), powmod(-7, 1000, m));
+        }
+    }
+    big_integer::thresholds = saved;
+    EXPECT_THROW(barrett_reducer(-5), std::runtime_error);
+}
+
+TEST(correctness, gcd)
+{
+    EXPECT_EQ(gcd(0, 0), 0);
+    EXPECT_EQ(gcd(0, -5), 5);
+    EXPECT_EQ(gcd(-12, 18), 6);
+    EXPECT_EQ(lcm(-4, 6), 12);
+    EXPECT_EQ(lcm(0, 6), 0);
+
+    big_integer::algorithm_thresholds saved = big_integer::thresholds;
+    for (size_t limit : {saved.half_gcd, size_t(3)})
+    {
+        big_integer::thresholds.half_gcd = limit;
+        for (int i = 0; i < 10; i++)
+        {
+            big_integer c = big_integer(rand()) * rand() + 1;
+            big_integer a = c * (big_integer(1) << (50 * i * i)) / 7 * 12345 * c;
+            big_integer b = -c * ((big_integer(1) << (45 * i * i + 7)) / 11 + rand());
+
+            big_integer x = a.abs(), y = b.abs();
+            while (!y.is_zero())
+            {
+                big_integer r = x % y;
+                x = y;
+                y = r;
+            }
+            EXPECT_EQ(gcd(a, b), x);
+            EXPECT_EQ(lcm(a, b), a.abs() / x * b.abs());
+
+            big_integer s, t;
+            EXPECT_EQ(gcdext(a, b, s, t), x);
+            EXPECT_EQ(a * s + b * t, x);
+            EXPECT_TRUE(s.abs() * 2 * x <= b.abs());
+            EXPECT_TRUE(t.abs() * 2 * x <= a.abs());
+        }
+    }
+    big_integer::thresholds = saved;
+
+    big_integer m = (big_integer(1) << 521) - 1;
+    big_integer inv = invert(-12345, m);
+    EXPECT_EQ((inv * -12345 % m + m) % m, 1);
+    EXPECT_EQ(invert(3, 1), 0);
+    EXPECT_THROW(invert(6, 9), std::runtime_error);
+}
+
+TEST(correctness, gcd_zero_operand)
+{
+    big_integer s, t;
+    EXPECT_EQ(gcdext(0, 5, s, t), 5);
+    EXPECT_EQ(s, 0);
+    EXPECT_EQ(t, 1);
+    EXPECT_EQ(gcdext(0, -5, s, t), 5);
+    EXPECT_EQ(s, 0);
+    EXPECT_EQ(t, -1);
+    EXPECT_EQ(invert(0, 1), 0);
+    EXPECT_THROW(invert(0, 7), std::runtime_error);
+
+    //long enough for the half gcd
+    big_integer big = pow_ui(3, 20000);
+    EXPECT_EQ(gcd(0, big), big);
+    EXPECT_EQ(gcd(-big, 0), big);
+    EXPECT_EQ(gcdext(0, -big, s, t), big);
+    EXPECT_EQ(s, 0);
+    EXPECT_EQ(t, -1);
+}
+
+TEST(correctness, roots)
+{
+    EXPECT_EQ(isqrt(0), 0);
+    EXPECT_EQ(isqrt(15), 3);
+    EXPECT_EQ(isqrt(16), 4);
+    EXPECT_EQ(iroot(-27, 3), -3);
+    EXPECT_EQ(iroot(1000, 1), 1000);
+    EXPECT_EQ(iroot(1000, 100), 1);
+    EXPECT_THROW(isqrt(-1), std::runtime_error);
+    EXPECT_THROW(iroot(-16, 4), std::runtime_error);
+    EXPECT_THROW(iroot(16, 0), std::runtime_error);
+
+    for (int i = 1; i < 30; i++)
+    {
+        big_integer a = (big_integer(1) << (37 * i * i)) / 13 + rand();
+        big_integer rem;
+        big_integer s = isqrt_rem(a, rem);
+        EXPECT_TRUE(rem >= 0 && rem <= 2 * s);
+        EXPECT_EQ(s * s + rem, a);
+        EXPECT_TRUE(is_perfect_square(s * s));
+        EXPECT_FALSE(is_perfect_square(s * s + 1));
+
+        unsigned int k = 3 + i % 5;
+        big_integer r = iroot(a, k);
+        big_integer p = 1, q = 1;
+        for (unsigned int j = 0; j < k; j++)
+        {
+            p *= r;
+            q *= r + 1;
+        }
+        EXPECT_TRUE(p <= a && a < q);
+    }
+}
+
+TEST(correctness, pow)
+{
+    EXPECT_EQ(pow(0, 0), 1);
+    EXPECT_EQ(pow(0, 5), 0);
+    EXPECT_EQ(pow(-2, 3), -8);
+    EXPECT_EQ(pow(-3, 4), 81);
+    EXPECT_EQ(pow(big_integer(1) << 40, 3), big_integer(1) << 120);
+    EXPECT_EQ(pow_ui(0, 0), 1);
+    EXPECT_EQ(pow_ui(10, 20), big_integer("100000000000000000000"));
+    EXPECT_EQ(pow_ui(4294967295ul, 2), big_integer("18446744065119617025"));
+
+    big_integer bases[] = {3, -7, 12, big_integer("98765432109876543210"), big_integer("-123456789") << 200};
+    for (big_integer const& b : bases)
+    {
+        big_integer expected = 1;
+        for (unsigned long e = 0; e < 150; e++)
+        {
+            EXPECT_EQ(pow(b, e), expected);
+            expected *= b;
+        }
+    }
+    big_integer expected = 1;
+    for (unsigned long e = 0; e < 150; e++)
+    {
+        EXPECT_EQ(pow_ui(1000000007ul * 6, e), expected);
+        expected *= big_integer(1000000007) * 6;
+    }
+}
+
+TEST(correctness, factorial_binomial_primorial)
+{
+    big_integer expected = 1;
+    for (unsigned long n = 0; n < 300; n++)
+    {
+        if (n > 0)
+        {
+            expected *= static_cast<int>(n);
+        }
+        EXPECT_EQ(factorial(n), expected);
+    }
+    EXPECT_EQ(factorial(3000, 4), factorial(3000));
+
+    std::vector<big_integer> row(1, 1);
+    for (unsigned long n = 1; n <= 200; n++)
+    {
+        std::vector<big_integer> next(n + 1, 1);
+        for (unsigned long k = 1; k < n; k++)
+        {
+            next[k] = row[k - 1] + row[k];
+        }
+        row = next;
+    }
+    for (unsigned long k = 0; k <= 200; k++)
+    {
+        EXPECT_EQ(binomial(200, k), row[k]);
+    }
+    EXPECT_EQ(binomial(200, 201), 0);
+    EXPECT_EQ(binomial(10000, 3), big_integer(10000) * 9999 * 9998 / 6);
+    EXPECT_EQ(binomial(5000, 2500, 3), factorial(5000) / factorial(2500).square());
+
+    EXPECT_EQ(primorial(1), 1);
+    EXPECT_EQ(primorial(30), big_integer("6469693230"));
+    EXPECT_EQ(primorial(2000) % 1999, 0);
+    EXPECT_EQ(primorial(2000, 2), primorial(2000));
+}
+
+TEST(correctness, product_and_remainder_trees)
+{
+    EXPECT_EQ(product_tree(nullptr, 0).root(), 1);
+    EXPECT_TRUE(remainder_tree(5, product_tree(nullptr, 0)).empty());
+    big_integer zero = 0;
+    EXPECT_THROW(product_tree(&zero, 1), std::runtime_error);
+
+    std::vector<big_integer> xs;
+    for (int i = 0; i < 37; i++)
+    {
+        xs.push_back((big_integer(rand()) << (40 * i)) + rand() + 1);
+    }
+    xs.push_back(1);
+    big_integer product = 1;
+    for (big_integer const& x : xs)
+    {
+        product *= x;
+    }
+
+    for (unsigned int threads : {1u, 3u})
+    {
+        product_tree tree(xs.data(), xs.size(), threads);
+        EXPECT_EQ(tree.size(), xs.size());
+        EXPECT_EQ(tree.root(), product);
+
+        big_integer x = -(product * rand() + (big_integer(1) << 1000) - 1);
+        std::vector<big_integer> rems = remainder_tree(x, tree, threads);
+        ASSERT_EQ(rems.size(), xs.size());
+        for (size_t i = 0; i < xs.size(); i++)
+        {
+            EXPECT_EQ(rems[i], (x % xs[i] + xs[i]) % xs[i]);
+        }
+    }
+}
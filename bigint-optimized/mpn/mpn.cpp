@@ -0,0 +1,814 @@
+//
+// Arithmetic on spans of digits: a digit_t pointer and a length, the lowest digit first
+//
+
+#include "mpn.h"
+#include "big_integer.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace mpn {
+
+typedef big_integer::double_digit_t double_digit_t;
+
+const digit_t DIGIT_MAX = std::numeric_limits <digit_t>::max();
+const int BASE = std::numeric_limits <digit_t>::digits;
+
+double_digit_t double_digit_cast(digit_t x) {
+    return static_cast <digit_t> (x);
+}
+
+digit_t digit_cast(double_digit_t x) {
+    return static_cast <digit_t> (x & DIGIT_MAX);
+}
+
+//r[0, rn) += b[0, bn), rn >= bn, returns the carry out of r
+digit_t add_to(digit_t* r, size_t rn, digit_t const* b, size_t bn) {
+    double_digit_t carry = 0;
+    double_digit_t c;
+    size_t i = 0;
+    for (; i < bn; i++) {
+        c = carry + r[i] + b[i];
+        r[i] = digit_cast(c);
+        carry = c >> BASE;
+    }
+    for (; carry && i < rn; i++) {
+        c = carry + r[i];
+        r[i] = digit_cast(c);
+        carry = c >> BASE;
+    }
+    return digit_cast(carry);
+}
+
+//r[0, rn) -= b[0, bn), rn >= bn, returns the borrow out of r
+digit_t sub_from(digit_t* r, size_t rn, digit_t const* b, size_t bn) {
+    double_digit_t carry = 1;
+    double_digit_t c;
+    size_t i = 0;
+    for (; i < bn; i++) {
+        c = carry + r[i] + (~b[i]);
+        r[i] = digit_cast(c);
+        carry = c >> BASE;
+    }
+    for (; !carry && i < rn; i++) {
+        c = carry + r[i] + DIGIT_MAX;
+        r[i] = digit_cast(c);
+        carry = c >> BASE;
+    }
+    return digit_cast(1 - carry);
+}
+
+//r[0, n) = a[0, n) + b[0, n), r may alias a or b, returns the carry
+digit_t add_n(digit_t* r, digit_t const* a, digit_t const* b, size_t n) {
+    double_digit_t carry = 0;
+    double_digit_t c;
+    for (size_t i = 0; i < n; i++) {
+        c = carry + a[i] + b[i];
+        r[i] = digit_cast(c);
+        carry = c >> BASE;
+    }
+    return digit_cast(carry);
+}
+
+//r[0, n) = a[0, n) - b[0, n), r may alias a or b, returns the borrow
+digit_t sub_n(digit_t* r, digit_t const* a, digit_t const* b, size_t n) {
+    double_digit_t carry = 1;
+    double_digit_t c;
+    for (size_t i = 0; i < n; i++) {
+        c = carry + a[i] + (~b[i]);
+        r[i] = digit_cast(c);
+        carry = c >> BASE;
+    }
+    return digit_cast(1 - carry);
+}
+
+int cmp_n(digit_t const* a, digit_t const* b, size_t n) {
+    for (size_t i = n; i-- > 0;) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+//r[0, n) = a[0, n) * d, r may alias a, returns the carry
+digit_t mul_1(digit_t* r, digit_t const* a, size_t n, digit_t d) {
+    double_digit_t carry = 0;
+    double_digit_t c;
+    for (size_t i = 0; i < n; i++) {
+        c = double_digit_cast(a[i]) * d + carry;
+        r[i] = digit_cast(c);
+        carry = c >> BASE;
+    }
+    return digit_cast(carry);
+}
+
+//r[0, n) = a[0, n) / d where d divides a, r may alias a: the odd part of d is divided out
+//by multiplying with its inverse modulo B instead of a hardware division per digit
+void divexact_1(digit_t* r, digit_t const* a, size_t n, digit_t d) {
+    size_t shift = 0;
+    while (!(d & 1)) {
+        d >>= 1;
+        shift++;
+    }
+    digit_t inv = d;
+    for (size_t i = 0; i < 5; i++) {
+        inv *= 2 - d * inv;
+    }
+    digit_t borrow = 0;
+    for (size_t i = 0; i < n; i++) {
+        digit_t x = a[i];
+        if (shift) {
+            x = (x >> shift) | (i + 1 < n ? digit_cast(double_digit_cast(a[i + 1]) << (BASE - shift)) : 0);
+        }
+        digit_t y = x - borrow;
+        digit_t q = y * inv;
+        r[i] = q;
+        borrow = digit_cast((double_digit_cast(q) * d) >> BASE) + (x < borrow);
+    }
+}
+
+//res[0, n + m) = a * b, schoolbook
+void long_mul(digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* res) {
+    std::fill(res, res + n + m, 0);
+    double_digit_t carry = 0, c = 0;
+    double_digit_t mul;
+    for (size_t i = 0; i < n; i++) {
+        carry = 0;
+        for (size_t j = 0; j < m; j++) {
+            mul = double_digit_cast(a[i]) * b[j];
+            c = carry + res[i + j] + digit_cast(mul);
+            res[i + j] = digit_cast(c);
+            carry = (c >> BASE) + (mul >> BASE);
+        }
+        res[i + m] = digit_cast(carry);
+    }
+}
+
+//res[0, 2n) = a * a, schoolbook: every product a[i] * a[j], i < j, is computed once and doubled
+void long_sqr(digit_t const* a, size_t n, digit_t* res) {
+    std::fill(res, res + 2 * n, 0);
+    double_digit_t carry = 0, c = 0;
+    double_digit_t mul;
+    for (size_t i = 0; i < n; i++) {
+        carry = 0;
+        for (size_t j = i + 1; j < n; j++) {
+            mul = double_digit_cast(a[i]) * a[j];
+            c = carry + res[i + j] + digit_cast(mul);
+            res[i + j] = digit_cast(c);
+            carry = (c >> BASE) + (mul >> BASE);
+        }
+        res[i + n] = digit_cast(carry);
+    }
+    for (size_t i = 2 * n; i-- > 1;) {
+        res[i] = (res[i] << 1) | (res[i - 1] >> (BASE - 1));
+    }
+    res[0] <<= 1;
+    carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        mul = double_digit_cast(a[i]) * a[i];
+        c = carry + res[2 * i] + digit_cast(mul);
+        res[2 * i] = digit_cast(c);
+        c = (c >> BASE) + res[2 * i + 1] + (mul >> BASE);
+        res[2 * i + 1] = digit_cast(c);
+        carry = c >> BASE;
+    }
+}
+
+//karatsuba needs at least 4 digits to make the operands shorter, toom-cook needs 16
+size_t karatsuba_threshold(bool square) {
+    auto const& t = big_integer::thresholds;
+    return std::max(square ? t.karatsuba_sqr : t.karatsuba_mul, size_t(4));
+}
+
+size_t toom_threshold(size_t k, bool square) {
+    auto const& t = big_integer::thresholds;
+    size_t threshold = (k == 3 ? (square ? t.toom3_sqr : t.toom3_mul) : (square ? t.toom4_sqr : t.toom4_mul));
+    return std::max(threshold, size_t(16));
+}
+
+size_t ntt_threshold(bool square) {
+    return square ? big_integer::thresholds.ntt_sqr : big_integer::thresholds.ntt_mul;
+}
+
+//the three-prime ntt works on 32-bit pieces of the digits, the first prime limits the transform length
+//and the product of the primes bounds the convolution terms by 2^86, enough for 2^22 pairs of pieces
+const size_t NTT_PIECES = BASE / 32;
+const size_t NTT_MAX_LENGTH = size_t(1) << 23;
+const uint32_t NTT_P1 = 998244353; // 119 * 2^23 + 1
+const uint32_t NTT_P2 = 167772161; // 5 * 2^25 + 1
+const uint32_t NTT_P3 = 469762049; // 7 * 2^26 + 1
+const uint32_t NTT_ROOT = 3; // a primitive root of all three primes
+
+__extension__ typedef unsigned __int128 ntt_carry_t;
+
+bool ntt_fits(size_t len) {
+    return len * NTT_PIECES <= NTT_MAX_LENGTH;
+}
+
+size_t ntt_length(size_t len) {
+    size_t l = 1;
+    while (l < len * NTT_PIECES) {
+        l <<= 1;
+    }
+    return l;
+}
+
+//scratch size needed by ntt_mul for a product of len digits: three residue arrays,
+//the transformed second operand and the table of roots
+size_t ntt_itch(size_t len) {
+    return 4 * ntt_length(len) + ntt_length(len) / 2;
+}
+
+//scratch size needed by mul_spans (or sqr_spans) when the longer operand has n digits:
+//karatsuba takes 2n + O(1) on each level, toom-cook at most 5n + O(1) and both recurse on at most n / 2 + 2 digits,
+//the ntt never recurses, so it adds its own scratch once
+size_t product_itch(size_t n, bool square) {
+    size_t itch = (n >= ntt_threshold(square) ? ntt_itch(2 * n + 4) : 0);
+    size_t toom_min = std::min(toom_threshold(3, square), toom_threshold(4, square));
+    while (n >= karatsuba_threshold(square)) {
+        size_t h = (n + 1) / 2;
+        itch += (n >= toom_min ? 5 * n + 64 : 4 * (h + 1));
+        n = h + 1;
+    }
+    return itch;
+}
+
+void mul_spans(digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* res, digit_t* scratch);
+void sqr_spans(digit_t const* a, size_t n, digit_t* res, digit_t* scratch);
+
+//n >= m > (n + 1) / 2: a = a1 * B^h + a0, b = b1 * B^h + b0,
+//a * b = a1b1 * B^2h + ((a0 + a1)(b0 + b1) - a1b1 - a0b0) * B^h + a0b0
+void karatsuba_mul(digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* res, digit_t* scratch) {
+    size_t h = (n + 1) / 2;
+    mul_spans(a, h, b, h, res, scratch);
+    mul_spans(a + h, n - h, b + h, m - h, res + 2 * h, scratch);
+
+    digit_t* sa = scratch;
+    digit_t* sb = sa + h + 1;
+    digit_t* mid = sb + h + 1;
+    std::copy(a, a + h, sa);
+    sa[h] = add_to(sa, h, a + h, n - h);
+    std::copy(b, b + h, sb);
+    sb[h] = add_to(sb, h, b + h, m - h);
+    mul_spans(sa, h + 1, sb, h + 1, mid, mid + 2 * (h + 1));
+
+    size_t mid_len = std::min(2 * (h + 1), n + m - h);
+    sub_from(mid, mid_len, res, 2 * h);
+    sub_from(mid, mid_len, res + 2 * h, n + m - 2 * h);
+    add_to(res + h, n + m - h, mid, mid_len);
+}
+
+//a * a = a1^2 * B^2h + ((a0 + a1)^2 - a1^2 - a0^2) * B^h + a0^2
+void karatsuba_sqr(digit_t const* a, size_t n, digit_t* res, digit_t* scratch) {
+    size_t h = (n + 1) / 2;
+    sqr_spans(a, h, res, scratch);
+    sqr_spans(a + h, n - h, res + 2 * h, scratch);
+
+    digit_t* sa = scratch;
+    digit_t* mid = sa + h + 1;
+    std::copy(a, a + h, sa);
+    sa[h] = add_to(sa, h, a + h, n - h);
+    sqr_spans(sa, h + 1, mid, mid + 2 * (h + 1));
+
+    size_t mid_len = std::min(2 * (h + 1), 2 * n - h);
+    sub_from(mid, mid_len, res, 2 * h);
+    sub_from(mid, mid_len, res + 2 * h, 2 * (n - h));
+    add_to(res + h, 2 * n - h, mid, mid_len);
+}
+
+//a value of the toom-cook polynomials at some point: a magnitude of the common length and a sign
+struct toom_value {
+    digit_t* digits;
+    bool neg;
+};
+
+//r = a + b or r = a - b, r may alias a or b
+void toom_add(toom_value& r, toom_value const& a, toom_value const& b, size_t len, bool subtract) {
+    bool a_neg = a.neg;
+    bool b_neg = (b.neg != subtract);
+    if (a_neg == b_neg) {
+        add_n(r.digits, a.digits, b.digits, len);
+        r.neg = a_neg;
+    }
+    else if (cmp_n(a.digits, b.digits, len) >= 0) {
+        sub_n(r.digits, a.digits, b.digits, len);
+        r.neg = a_neg;
+    }
+    else {
+        sub_n(r.digits, b.digits, a.digits, len);
+        r.neg = b_neg;
+    }
+}
+
+//v += u * x or v -= u * x, tmp is a scratch value of the same length
+void toom_addmul_1(toom_value& v, toom_value const& u, int x, toom_value& tmp, size_t len, bool subtract) {
+    mul_1(tmp.digits, u.digits, len, digit_cast(std::abs(x)));
+    tmp.neg = (u.neg != (x < 0));
+    toom_add(v, v, tmp, len, subtract);
+}
+
+//v = a(x) where a[0, n) is split into k pieces of s digits
+void toom_eval(toom_value& v, digit_t const* a, size_t n, size_t s, size_t k, int x, toom_value& tmp, size_t len) {
+    std::fill(v.digits, v.digits + len, 0);
+    v.neg = false;
+    for (size_t i = k; i-- > 0;) {
+        mul_1(v.digits, v.digits, len, digit_cast(std::abs(x)));
+        v.neg = (v.neg != (x < 0));
+        std::fill(tmp.digits, tmp.digits + len, 0);
+        std::copy(a + i * s, a + std::min(n, (i + 1) * s), tmp.digits);
+        tmp.neg = false;
+        toom_add(v, v, tmp, len, false);
+    }
+}
+
+//toom-k for n >= m > (k - 1) * s, where s = ceil(n / k): a and b are split into k pieces of s digits,
+//the product polynomial is evaluated at 2k - 2 finite points and infinity, recovered through
+//newton divided differences and then converted from newton to monomial basis, b == nullptr squares a
+void toom_product(digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* res, digit_t* scratch, size_t k) {
+    static const int points[] = {0, 1, -1, 2, -2, 3};
+    size_t s = (n + k - 1) / k;
+    size_t e = s + 1;
+    size_t len = 2 * s + 4;
+    size_t d = 2 * k - 2;
+
+    toom_value pa = {scratch, false};
+    toom_value pb = {pa.digits + e, false};
+    toom_value tmp = {pb.digits + e, false};
+    toom_value r[7];
+    for (size_t i = 0; i <= d; i++) {
+        r[i] = {tmp.digits + (i + 1) * len, false};
+    }
+    digit_t* rest = tmp.digits + (d + 2) * len;
+
+    for (size_t i = 0; i < d; i++) {
+        toom_eval(pa, a, n, s, k, points[i], tmp, e);
+        if (b == nullptr) {
+            sqr_spans(pa.digits, e, r[i].digits, rest);
+            r[i].neg = false;
+        }
+        else {
+            toom_eval(pb, b, m, s, k, points[i], tmp, e);
+            mul_spans(pa.digits, e, pb.digits, e, r[i].digits, rest);
+            r[i].neg = (pa.neg != pb.neg);
+        }
+        std::fill(r[i].digits + 2 * e, r[i].digits + len, 0);
+    }
+    size_t ta = n - (k - 1) * s;
+    size_t tb = m - (k - 1) * s;
+    if (b == nullptr) {
+        sqr_spans(a + (k - 1) * s, ta, r[d].digits, rest);
+    }
+    else {
+        mul_spans(a + (k - 1) * s, ta, b + (k - 1) * s, tb, r[d].digits, rest);
+    }
+    std::fill(r[d].digits + ta + tb, r[d].digits + len, 0);
+
+    //remove the leading coefficient, the rest has degree d - 1
+    for (size_t i = 1; i < d; i++) {
+        int pw = 1;
+        for (size_t j = 0; j < d; j++) {
+            pw *= points[i];
+        }
+        toom_addmul_1(r[i], r[d], pw, tmp, len, true);
+    }
+    for (size_t j = 1; j < d; j++) {
+        for (size_t i = d - 1; i >= j; i--) {
+            toom_add(r[i], r[i], r[i - 1], len, true);
+            int den = points[i] - points[i - j];
+            divexact_1(r[i].digits, r[i].digits, len, digit_cast(std::abs(den)));
+            r[i].neg = (r[i].neg != (den < 0));
+        }
+    }
+    for (size_t j = d - 1; j-- > 0;) {
+        if (points[j] == 0) {
+            continue;
+        }
+        for (size_t i = j; i + 1 < d; i++) {
+            toom_addmul_1(r[i], r[i + 1], points[j], tmp, len, true);
+        }
+    }
+
+    std::fill(res, res + n + m, 0);
+    for (size_t i = 0; i <= d; i++) {
+        add_to(res + i * s, n + m - i * s, r[i].digits, std::min(len, n + m - i * s));
+    }
+}
+
+void toom_mul(digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* res, digit_t* scratch, size_t k) {
+    toom_product(a, n, b, m, res, scratch, k);
+}
+
+void toom_sqr(digit_t const* a, size_t n, digit_t* res, digit_t* scratch, size_t k) {
+    toom_product(a, n, nullptr, n, res, scratch, k);
+}
+
+uint32_t pow_mod(uint64_t x, uint64_t e, uint32_t p) {
+    uint64_t res = 1;
+    for (x %= p; e; e >>= 1) {
+        if (e & 1) {
+            res = res * x % p;
+        }
+        x = x * x % p;
+    }
+    return uint32_t(res);
+}
+
+//in-place number theoretic transform of a[0, len) modulo P, len is a power of two,
+//roots gets len / 2 powers of the root of unity
+template <uint32_t P>
+void ntt_transform(digit_t* a, size_t len, digit_t* roots, bool inverse) {
+    uint64_t w = pow_mod(NTT_ROOT, (P - 1) / len, P);
+    roots[0] = 1;
+    for (size_t i = 1; i < len / 2; i++) {
+        roots[i] = static_cast <digit_t> (roots[i - 1] * w % P);
+    }
+    for (size_t i = 1, j = 0; i < len; i++) {
+        size_t bit = len >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(a[i], a[j]);
+        }
+    }
+    for (size_t half = 1; half < len; half <<= 1) {
+        size_t step = len / (2 * half);
+        for (size_t i = 0; i < len; i += 2 * half) {
+            for (size_t j = 0; j < half; j++) {
+                uint64_t u = a[i + j];
+                uint64_t v = uint64_t(a[i + j + half]) * roots[j * step] % P;
+                a[i + j] = static_cast <digit_t> (u + v >= P ? u + v - P : u + v);
+                a[i + j + half] = static_cast <digit_t> (u >= v ? u - v : u + P - v);
+            }
+        }
+    }
+    if (inverse) {
+        std::reverse(a + 1, a + len);
+        uint64_t inv = pow_mod(len, P - 2, P);
+        for (size_t i = 0; i < len; i++) {
+            a[i] = static_cast <digit_t> (a[i] * inv % P);
+        }
+    }
+}
+
+//writes the 32-bit pieces of x[0, n) reduced modulo P to r[0, len), zero padded
+template <uint32_t P>
+void ntt_load(digit_t const* x, size_t n, digit_t* r, size_t len) {
+    size_t pieces = n * NTT_PIECES;
+    for (size_t i = 0; i < pieces; i++) {
+        r[i] = static_cast <digit_t> (uint32_t(x[i / NTT_PIECES] >> (32 * (i % NTT_PIECES))) % P);
+    }
+    std::fill(r + pieces, r + len, 0);
+}
+
+//r[0, len) = the cyclic convolution of the pieces of a and b modulo P, squares a if b is null
+template <uint32_t P>
+void ntt_convolve(digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* r, size_t len, digit_t* scratch) {
+    digit_t* roots = scratch + len;
+    ntt_load <P> (a, n, r, len);
+    ntt_transform <P> (r, len, roots, false);
+    if (b == nullptr) {
+        for (size_t i = 0; i < len; i++) {
+            r[i] = static_cast <digit_t> (uint64_t(r[i]) * r[i] % P);
+        }
+    }
+    else {
+        ntt_load <P> (b, m, scratch, len);
+        ntt_transform <P> (scratch, len, roots, false);
+        for (size_t i = 0; i < len; i++) {
+            r[i] = static_cast <digit_t> (uint64_t(r[i]) * scratch[i] % P);
+        }
+    }
+    ntt_transform <P> (r, len, roots, true);
+}
+
+//res[0, n + m) = a * b through three transforms and garner's reconstruction of the terms,
+//b == nullptr squares a with one forward transform per prime
+void ntt_product(digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* res, digit_t* scratch) {
+    static const uint64_t inv_p1 = pow_mod(NTT_P1, NTT_P2 - 2, NTT_P2);
+    static const uint64_t inv_p1p2 = pow_mod(uint64_t(NTT_P1) * NTT_P2, NTT_P3 - 2, NTT_P3);
+    size_t len = ntt_length(n + m);
+    digit_t* r1 = scratch;
+    digit_t* r2 = r1 + len;
+    digit_t* r3 = r2 + len;
+    ntt_convolve <NTT_P1> (a, n, b, m, r1, len, r3 + len);
+    ntt_convolve <NTT_P2> (a, n, b, m, r2, len, r3 + len);
+    ntt_convolve <NTT_P3> (a, n, b, m, r3, len, r3 + len);
+
+    std::fill(res, res + n + m, 0);
+    ntt_carry_t carry = 0;
+    for (size_t i = 0; i < (n + m) * NTT_PIECES; i++) {
+        uint64_t v2 = (r2[i] + NTT_P2 - r1[i] % NTT_P2) * inv_p1 % NTT_P2;
+        uint64_t t = r1[i] + NTT_P1 * v2;
+        uint64_t v3 = (r3[i] + NTT_P3 - t % NTT_P3) * inv_p1p2 % NTT_P3;
+        carry += t + ntt_carry_t(uint64_t(NTT_P1) * NTT_P2) * v3;
+        res[i / NTT_PIECES] |= digit_cast(double_digit_cast(uint32_t(carry)) << (32 * (i % NTT_PIECES)));
+        carry >>= 32;
+    }
+}
+
+void ntt_mul(digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* res, digit_t* scratch) {
+    ntt_product(a, n, b, m, res, scratch);
+}
+
+void ntt_sqr(digit_t const* a, size_t n, digit_t* res, digit_t* scratch) {
+    ntt_product(a, n, nullptr, n, res, scratch);
+}
+
+//res[0, n + m) = a * b for n >= m, picks the algorithm by the length of the shorter operand
+void mul_spans(digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* res, digit_t* scratch) {
+    if (m < karatsuba_threshold(false)) {
+        long_mul(a, n, b, m, res);
+        return;
+    }
+    if (m >= ntt_threshold(false) && ntt_fits(n + m)) {
+        ntt_mul(a, n, b, m, res, scratch);
+        return;
+    }
+    if (m <= (n + 1) / 2) {
+        //unbalanced operands: multiply b by m-digit chunks of a
+        std::fill(res, res + n + m, 0);
+        digit_t* chunk = scratch;
+        for (size_t i = 0; i < n; i += m) {
+            size_t len = std::min(m, n - i);
+            mul_spans(b, m, a + i, len, chunk, chunk + 2 * m);
+            add_to(res + i, n + m - i, chunk, len + m);
+        }
+        return;
+    }
+    if (m >= toom_threshold(4, false) && m > 3 * ((n + 3) / 4)) {
+        toom_mul(a, n, b, m, res, scratch, 4);
+    }
+    else if (m >= toom_threshold(3, false) && m > 2 * ((n + 2) / 3)) {
+        toom_mul(a, n, b, m, res, scratch, 3);
+    }
+    else {
+        karatsuba_mul(a, n, b, m, res, scratch);
+    }
+}
+
+//res[0, 2n) = a * a, picks the squaring variant of the algorithm by the length of a
+void sqr_spans(digit_t const* a, size_t n, digit_t* res, digit_t* scratch) {
+    if (n < karatsuba_threshold(true)) {
+        long_sqr(a, n, res);
+    }
+    else if (n >= ntt_threshold(true) && ntt_fits(2 * n)) {
+        ntt_sqr(a, n, res, scratch);
+    }
+    else if (n >= toom_threshold(4, true)) {
+        toom_sqr(a, n, res, scratch, 4);
+    }
+    else if (n >= toom_threshold(3, true)) {
+        toom_sqr(a, n, res, scratch, 3);
+    }
+    else {
+        karatsuba_sqr(a, n, res, scratch);
+    }
+}
+
+//r[0, n) = a[0, n) << shift, shift < BASE, r may alias a, returns the bits shifted out
+digit_t lshift(digit_t* r, digit_t const* a, size_t n, size_t shift) {
+    if (shift == 0) {
+        std::copy(a, a + n, r);
+        return 0;
+    }
+    digit_t out = a[n - 1] >> (BASE - shift);
+    for (size_t i = n; i-- > 1;) {
+        r[i] = digit_cast((double_digit_cast(a[i]) << shift) | (a[i - 1] >> (BASE - shift)));
+    }
+    r[0] = digit_cast(double_digit_cast(a[0]) << shift);
+    return out;
+}
+
+//r[0, n) = a[0, n) >> shift, shift < BASE, r may alias a
+void rshift(digit_t* r, digit_t const* a, size_t n, size_t shift) {
+    if (shift == 0) {
+        std::copy(a, a + n, r);
+        return;
+    }
+    for (size_t i = 0; i + 1 < n; i++) {
+        r[i] = digit_cast((a[i] >> shift) | (double_digit_cast(a[i + 1]) << (BASE - shift)));
+    }
+    r[n - 1] = a[n - 1] >> shift;
+}
+
+//r[0, n) += a[0, n) * d, returns the digit to add to r[n]
+digit_t addmul_1(digit_t* r, digit_t const* a, size_t n, digit_t d) {
+    double_digit_t carry = 0;
+    double_digit_t mul;
+    for (size_t i = 0; i < n; i++) {
+        mul = double_digit_cast(a[i]) * d + carry + r[i];
+        r[i] = digit_cast(mul);
+        carry = mul >> BASE;
+    }
+    return digit_cast(carry);
+}
+
+//r[0, n) -= a[0, n) * d, returns the digit to subtract from r[n]
+digit_t submul_1(digit_t* r, digit_t const* a, size_t n, digit_t d) {
+    double_digit_t carry = 0;
+    double_digit_t mul;
+    for (size_t i = 0; i < n; i++) {
+        mul = double_digit_cast(a[i]) * d + carry;
+        digit_t lo = digit_cast(mul);
+        carry = (mul >> BASE) + (r[i] < lo);
+        r[i] -= lo;
+    }
+    return digit_cast(carry);
+}
+
+//q[0, n - m) = a / b, a[0, m) = a % b, where b[m - 1] has its top bit set and a[n - m, n) < b,
+//one trial digit per quotient digit from the top two digits, refined by b[m - 2] so that at most one add back is needed
+void long_div(digit_t* q, digit_t* a, size_t n, digit_t const* b, size_t m) {
+    digit_t div = b[m - 1];
+    for (size_t i = n - m; i-- > 0;) {
+        double_digit_t num = (double_digit_cast(a[i + m]) << BASE) | a[i + m - 1];
+        double_digit_t qt = DIGIT_MAX;
+        if (a[i + m] < div) {
+            qt = num / div;
+        }
+        double_digit_t rt = num - qt * div;
+        while (m > 1 && rt <= DIGIT_MAX && qt * b[m - 2] > ((rt << BASE) | a[i + m - 2])) {
+            qt--;
+            rt += div;
+        }
+        digit_t borrow = submul_1(a + i, b, m, digit_cast(qt));
+        digit_t top = a[i + m];
+        a[i + m] = top - borrow;
+        if (top < borrow) {
+            qt--;
+            a[i + m] += add_n(a + i, a + i, b, m);
+        }
+        q[i] = digit_cast(qt);
+    }
+}
+
+size_t burnikel_ziegler_threshold() {
+    return std::max(big_integer::thresholds.burnikel_ziegler_div, size_t(4));
+}
+
+//scratch size needed by recursive_div for an m-digit divisor: a product of m digits and the scratch of that product
+size_t div_itch(size_t m) {
+    return m + product_itch(m, false);
+}
+
+void recursive_div(digit_t* q, digit_t* a, size_t qn, digit_t const* b, size_t m, digit_t* scratch);
+
+//divides a[0, qn + m) by b[0, m) where a[qn, qn + m) <= b: when the top equals b the quotient is capped
+//at B^qn - 1 and the remainder is left unreduced, the caller's correction takes care of it
+void recursive_div_step(digit_t* q, digit_t* a, size_t qn, digit_t const* b, size_t m, digit_t* scratch) {
+    if (cmp_n(a + qn, b, m) == 0) {
+        std::fill(q, q + qn, DIGIT_MAX);
+        std::fill(a + qn, a + qn + m, 0);
+        add_to(a, qn + m, b, m);
+        return;
+    }
+    recursive_div(q, a, qn, b, m, scratch);
+}
+
+//a -= q * b0 * B^shift for the low part b0 = b[0, k) of b, where the high part has been divided already:
+//while the result is negative q is decreased and b added back, a[shift, shift + m] holds the result
+void recursive_div_correct(digit_t* q, size_t qn, digit_t* a, size_t shift, digit_t const* b, size_t m, size_t k,
+                           digit_t* scratch) {
+    digit_t* t = scratch;
+    if (qn >= k) {
+        mul_spans(q, qn, b, k, t, t + qn + k);
+    }
+    else {
+        mul_spans(b, k, q, qn, t, t + qn + k);
+    }
+    digit_t borrow = sub_from(a + shift, m + 1, t, qn + k);
+    digit_t one = 1;
+    while (borrow) {
+        sub_from(q, qn, &one, 1);
+        borrow -= add_to(a + shift, m + 1, b, m);
+    }
+}
+
+//burnikel-ziegler: q[0, qn) = a / b, a[0, m) = a % b for a[0, qn + m) with a[qn, qn + m) < b, qn <= m,
+//b normalized; the quotient is found in two halves, each by dividing by the top m - k digits of b
+//and correcting by the product of the quotient half and the low k digits
+void recursive_div(digit_t* q, digit_t* a, size_t qn, digit_t const* b, size_t m, digit_t* scratch) {
+    if (qn < burnikel_ziegler_threshold() || m < burnikel_ziegler_threshold()) {
+        long_div(q, a, qn + m, b, m);
+        return;
+    }
+    size_t k = qn / 2;
+    recursive_div_step(q + k, a + 2 * k, qn - k, b + k, m - k, scratch);
+    recursive_div_correct(q + k, qn - k, a, k, b, m, k, scratch);
+    recursive_div_step(q, a + k, k, b + k, m - k, scratch);
+    recursive_div_correct(q, k, a, 0, b, m, k, scratch);
+}
+
+digit_t divrem_1(digit_t* r, digit_t const* a, size_t n, digit_t d) {
+    double_digit_t c, carry = 0;
+    for (size_t i = n; i-- > 0;) {
+        c = (carry << BASE) + a[i];
+        r[i] = digit_cast(c / d);
+        carry = c % d;
+    }
+    return digit_cast(carry);
+}
+
+digit_t mod_1(digit_t const* a, size_t n, digit_t d) {
+    double_digit_t carry = 0;
+    for (size_t i = n; i-- > 0;) {
+        carry = (carry * (double_digit_cast(1) + DIGIT_MAX) + a[i]) % d;
+    }
+    return digit_cast(carry);
+}
+
+//the unbalanced case of mul_spans multiplies by m-digit chunks, each into 2m digits of the scratch
+size_t mul_itch(size_t n, size_t m) {
+    return std::max(product_itch(n, false), 2 * m + product_itch(m, false));
+}
+
+void mul(digit_t* r, digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* scratch) {
+    mul_spans(a, n, b, m, r, scratch);
+}
+
+//the low product splits at k of about 0.7n: a0 * b0 in full and the low n - k digits of a1 * b0 and a0 * b1,
+//which comes to about 0.8 of a full product under karatsuba and toom-cook
+size_t mullo_split(size_t n) {
+    return n - n * 3 / 10;
+}
+
+size_t mullo_itch(size_t n) {
+    if (n < karatsuba_threshold(false)) {
+        return 0;
+    }
+    size_t k = mullo_split(n);
+    return std::max(2 * k + mul_itch(k, k), n - k + mullo_itch(n - k));
+}
+
+void mullo_n(digit_t* r, digit_t const* a, digit_t const* b, size_t n, digit_t* scratch) {
+    if (n < karatsuba_threshold(false)) {
+        //the partial products of the columns below n only
+        mul_1(r, a, n, b[0]);
+        for (size_t i = 1; i < n; i++) {
+            addmul_1(r + i, a, n - i, b[i]);
+        }
+        return;
+    }
+    size_t k = mullo_split(n);
+    size_t h = n - k;
+    mul_spans(a, k, b, k, scratch, scratch + 2 * k);
+    std::copy(scratch, scratch + n, r);
+    mullo_n(scratch, a + k, b, h, scratch + h);
+    add_n(r + k, r + k, scratch, h);
+    mullo_n(scratch, a, b + k, h, scratch + h);
+    add_n(r + k, r + k, scratch, h);
+}
+
+size_t sqr_itch(size_t n) {
+    return product_itch(n, true);
+}
+
+void sqr(digit_t* r, digit_t const* a, size_t n, digit_t* scratch) {
+    sqr_spans(a, n, r, scratch);
+}
+
+//the shifted divisor, the shifted dividend with an extra digit and the scratch of the division itself
+size_t divrem_itch(size_t n, size_t m) {
+    if (m == 1) {
+        return 0;
+    }
+    return m + n + 1 + (m < burnikel_ziegler_threshold() ? 0 : div_itch(m));
+}
+
+//b is shifted to have the top bit set, then the quotient is found m digits at a time
+void divrem(digit_t* q, digit_t* r, digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* scratch) {
+    if (m == 1) {
+        r[0] = divrem_1(q, a, n, b[0]);
+        return;
+    }
+    size_t shift = 0;
+    while (!((b[m - 1] << shift) & (digit_t(1) << (BASE - 1)))) {
+        shift++;
+    }
+    digit_t* bn = scratch;
+    digit_t* an = scratch + m;
+    lshift(bn, b, m, shift);
+    an[n] = lshift(an, a, n, shift);
+
+    size_t qn = n + 1 - m;
+    if (m < burnikel_ziegler_threshold()) {
+        long_div(q, an, n + 1, bn, m);
+    }
+    else {
+        digit_t* div_scratch = an + n + 1;
+        size_t top = qn % m;
+        if (top) {
+            recursive_div(q + qn - top, an + qn - top, top, bn, m, div_scratch);
+        }
+        for (size_t i = qn - top; i > 0; i -= m) {
+            recursive_div(q + i - m, an + i - m, m, bn, m, div_scratch);
+        }
+    }
+    rshift(r, an, m, shift);
+}
+
+}
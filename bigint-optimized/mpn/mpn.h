@@ -0,0 +1,64 @@
+//
+// Arithmetic on spans of digits: a digit_t pointer and a length, the lowest digit first
+//
+
+#ifndef BIGINT_MPN_H
+#define BIGINT_MPN_H
+
+#include "digit_vector.h"
+#include <cstddef>
+
+//nothing here allocates: the functions that need temporaries take a scratch span of at least the size
+//reported by the matching *_itch function, which may be allocated once and reused between calls;
+//results never overlap the operands or the scratch unless said otherwise
+namespace mpn {
+    typedef digit_vector::digit_t digit_t;
+
+    //r[0, n) = a[0, n) + b[0, n), r may alias a or b, returns the carry
+    digit_t add_n(digit_t* r, digit_t const* a, digit_t const* b, size_t n);
+    //r[0, n) = a[0, n) - b[0, n), r may alias a or b, returns the borrow
+    digit_t sub_n(digit_t* r, digit_t const* a, digit_t const* b, size_t n);
+    //r[0, rn) += b[0, bn), rn >= bn, returns the carry out of r
+    digit_t add_to(digit_t* r, size_t rn, digit_t const* b, size_t bn);
+    //r[0, rn) -= b[0, bn), rn >= bn, returns the borrow out of r
+    digit_t sub_from(digit_t* r, size_t rn, digit_t const* b, size_t bn);
+    //the sign of a[0, n) - b[0, n)
+    int cmp_n(digit_t const* a, digit_t const* b, size_t n);
+
+    //r[0, n) = a[0, n) * d, r may alias a, returns the carry
+    digit_t mul_1(digit_t* r, digit_t const* a, size_t n, digit_t d);
+    //r[0, n) += a[0, n) * d, returns the digit to add to r[n]
+    digit_t addmul_1(digit_t* r, digit_t const* a, size_t n, digit_t d);
+    //r[0, n) -= a[0, n) * d, returns the digit to subtract from r[n]
+    digit_t submul_1(digit_t* r, digit_t const* a, size_t n, digit_t d);
+    //r[0, n) = a[0, n) / d, r may alias a, returns the remainder
+    digit_t divrem_1(digit_t* r, digit_t const* a, size_t n, digit_t d);
+    //a[0, n) % d
+    digit_t mod_1(digit_t const* a, size_t n, digit_t d);
+    //r[0, n) = a[0, n) / d where d divides a, r may alias a
+    void divexact_1(digit_t* r, digit_t const* a, size_t n, digit_t d);
+
+    //r[0, n) = a[0, n) << shift, shift < BASE, r may alias a, returns the bits shifted out
+    digit_t lshift(digit_t* r, digit_t const* a, size_t n, size_t shift);
+    //r[0, n) = a[0, n) >> shift, shift < BASE, r may alias a
+    void rshift(digit_t* r, digit_t const* a, size_t n, size_t shift);
+
+    //scratch digits needed by mul for n >= m
+    size_t mul_itch(size_t n, size_t m);
+    //r[0, n + m) = a[0, n) * b[0, m), n >= m >= 1
+    void mul(digit_t* r, digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* scratch);
+    //scratch digits needed by mullo_n
+    size_t mullo_itch(size_t n);
+    //r[0, n) = a[0, n) * b[0, n) mod B^n, about half the work of a schoolbook product, or 0.8 of a faster one
+    void mullo_n(digit_t* r, digit_t const* a, digit_t const* b, size_t n, digit_t* scratch);
+    //scratch digits needed by sqr
+    size_t sqr_itch(size_t n);
+    //r[0, 2n) = a[0, n)^2, n >= 1
+    void sqr(digit_t* r, digit_t const* a, size_t n, digit_t* scratch);
+    //scratch digits needed by divrem for n >= m
+    size_t divrem_itch(size_t n, size_t m);
+    //q[0, n - m + 1) = a[0, n) / b[0, m), r[0, m) = a % b, n >= m >= 1, b[m - 1] != 0
+    void divrem(digit_t* q, digit_t* r, digit_t const* a, size_t n, digit_t const* b, size_t m, digit_t* scratch);
+}
+
+#endif //BIGINT_MPN_H
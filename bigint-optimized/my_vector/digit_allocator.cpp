@@ -0,0 +1,158 @@
+//
+// Where digit buffers and scratch space come from
+//
+
+#include "digit_allocator.h"
+#include <algorithm>
+#include <new>
+
+namespace {
+    thread_local digit_allocator* current_allocator = nullptr;
+
+    struct heap_allocator : digit_allocator {
+        void* allocate(size_t bytes) override {
+            return operator new(bytes);
+        }
+
+        void deallocate(void* p, size_t) override {
+            operator delete(p);
+        }
+    };
+
+    const size_t POOL_CLASSES = 15; // MIN_BLOCK << 14 == MAX_BLOCK
+
+    struct free_block {
+        free_block* next;
+    };
+
+    struct pool_cache {
+        free_block* heads[POOL_CLASSES] = {};
+        size_t counts[POOL_CLASSES] = {};
+
+        pool_cache();
+        ~pool_cache();
+    };
+
+    //blocks freed by destructors of statics that run after the cache of the main thread is gone go to the heap
+    enum cache_state_t { UNBORN, ALIVE, DEAD };
+    thread_local cache_state_t cache_state = UNBORN;
+    thread_local pool_cache cache;
+
+    pool_cache::pool_cache() {
+        cache_state = ALIVE;
+    }
+
+    pool_cache::~pool_cache() {
+        for (size_t c = 0; c < POOL_CLASSES; c++) {
+            while (heads[c] != nullptr) {
+                free_block* next = heads[c]->next;
+                operator delete(heads[c]);
+                heads[c] = next;
+            }
+        }
+        cache_state = DEAD;
+    }
+
+    size_t pool_class(size_t bytes) {
+        size_t c = 0;
+        while ((pool_allocator::MIN_BLOCK << c) < bytes) {
+            c++;
+        }
+        return c;
+    }
+}
+
+bool digit_allocator::is_scoped() const {
+    return false;
+}
+
+digit_allocator* digit_allocator::current() {
+    return current_allocator != nullptr ? current_allocator : heap();
+}
+
+//never destroyed, buffers of static values are freed after the destructors of function-local statics run
+digit_allocator* digit_allocator::heap() {
+    static digit_allocator* const instance = new heap_allocator;
+    return instance;
+}
+
+digit_allocator::scope::scope(digit_allocator& a) : saved(current_allocator) {
+    current_allocator = &a;
+}
+
+digit_allocator::scope::~scope() {
+    current_allocator = saved;
+}
+
+void* pool_allocator::allocate(size_t bytes) {
+    if (bytes > MAX_BLOCK || cache_state == DEAD) {
+        return operator new(bytes);
+    }
+    size_t c = pool_class(bytes);
+    free_block* block = cache.heads[c];
+    if (block == nullptr) {
+        return operator new(MIN_BLOCK << c);
+    }
+    cache.heads[c] = block->next;
+    cache.counts[c]--;
+    return block;
+}
+
+void pool_allocator::deallocate(void* p, size_t bytes) {
+    if (bytes > MAX_BLOCK || cache_state == DEAD) {
+        operator delete(p);
+        return;
+    }
+    size_t c = pool_class(bytes);
+    if (cache.counts[c] == MAX_CACHED) {
+        operator delete(p);
+        return;
+    }
+    free_block* block = static_cast <free_block*> (p);
+    block->next = cache.heads[c];
+    cache.heads[c] = block;
+    cache.counts[c]++;
+}
+
+pool_allocator& pool_allocator::instance() {
+    static pool_allocator* const instance = new pool_allocator;
+    return *instance;
+}
+
+arena_allocator::arena_allocator(size_t chunk_bytes) : pos(nullptr), left(0), chunk_bytes(chunk_bytes) {}
+
+arena_allocator::~arena_allocator() {
+    release();
+}
+
+//chunks double in size, so a long computation takes a logarithmic number of them
+void* arena_allocator::allocate(size_t bytes) {
+    const size_t align = alignof(std::max_align_t);
+    bytes = (bytes + align - 1) / align * align;
+    if (bytes > left) {
+        size_t size = std::max(chunk_bytes, bytes);
+        chunks.push_back(operator new(size));
+        pos = static_cast <char*> (chunks.back());
+        left = size;
+        chunk_bytes *= 2;
+    }
+    void* p = pos;
+    pos += bytes;
+    left -= bytes;
+    return p;
+}
+
+void arena_allocator::deallocate(void*, size_t) {}
+
+bool arena_allocator::is_scoped() const {
+    return true;
+}
+
+void arena_allocator::release() {
+    for (void* chunk : chunks) {
+        operator delete(chunk);
+    }
+    chunks.clear();
+    pos = nullptr;
+    left = 0;
+}
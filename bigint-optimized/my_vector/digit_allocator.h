@@ -0,0 +1,109 @@
+//
+// Where digit buffers and scratch space come from
+//
+
+#ifndef BIGINT_DIGIT_ALLOCATOR_H
+#define BIGINT_DIGIT_ALLOCATOR_H
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+//the interface of std::pmr::memory_resource, which needs c++17: every thread allocates digits
+//from its current allocator, the global heap unless a scope installs another one
+struct digit_allocator {
+    virtual ~digit_allocator() = default;
+    //the memory is aligned for any digit type
+    virtual void* allocate(size_t bytes) = 0;
+    virtual void deallocate(void* p, size_t bytes) = 0;
+    //the memory is released in one shot, so copies never share it and a copy made outside of the scope
+    //takes the value out
+    virtual bool is_scoped() const;
+
+    static digit_allocator* current();
+    static digit_allocator* heap();
+
+    //installs the allocator for the current thread until the end of the scope
+    struct scope {
+        explicit scope(digit_allocator& a);
+        ~scope();
+        scope(scope const&) = delete;
+        scope& operator=(scope const&) = delete;
+
+    private:
+        digit_allocator* saved;
+    };
+};
+
+//caches freed blocks of up to MAX_BLOCK bytes per thread in power-of-two size classes, larger ones go to the heap;
+//a block may be freed on any thread and joins the cache of that thread
+struct pool_allocator : digit_allocator {
+    static const size_t MIN_BLOCK = 64;
+    static const size_t MAX_BLOCK = size_t(1) << 20;
+    static const size_t MAX_CACHED = 32;
+
+    void* allocate(size_t bytes) override;
+    void deallocate(void* p, size_t bytes) override;
+
+    static pool_allocator& instance();
+};
+
+//bumps a pointer through growing chunks and frees nothing before release() or the destructor;
+//every allocation on the thread inside its scope comes from the arena, including the growth of values
+//declared outside of it, values to keep have to be copied after the scope ends and before the release
+struct arena_allocator : digit_allocator {
+    explicit arena_allocator(size_t chunk_bytes = size_t(1) << 16);
+    ~arena_allocator();
+    arena_allocator(arena_allocator const&) = delete;
+    arena_allocator& operator=(arena_allocator const&) = delete;
+
+    void* allocate(size_t bytes) override;
+    void deallocate(void* p, size_t bytes) override;
+    bool is_scoped() const override;
+    void release();
+
+private:
+    std::vector <void*> chunks;
+    char* pos;
+    size_t left;
+    size_t chunk_bytes;
+};
+
+//the standard allocator interface over the allocator that is current when a container is made
+template <class T>
+struct allocator_adaptor {
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    allocator_adaptor() : alloc(digit_allocator::current()) {}
+
+    template <class U>
+    allocator_adaptor(allocator_adaptor <U> const& other) : alloc(other.alloc) {}
+
+    T* allocate(size_t n) {
+        return static_cast <T*> (alloc->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        alloc->deallocate(p, n * sizeof(T));
+    }
+
+    allocator_adaptor select_on_container_copy_construction() const {
+        return allocator_adaptor();
+    }
+
+    digit_allocator* alloc;
+};
+
+template <class T, class U>
+bool operator==(allocator_adaptor <T> const& a, allocator_adaptor <U> const& b) {
+    return a.alloc == b.alloc;
+}
+
+template <class T, class U>
+bool operator!=(allocator_adaptor <T> const& a, allocator_adaptor <U> const& b) {
+    return a.alloc != b.alloc;
+}
+
+#endif //BIGINT_DIGIT_ALLOCATOR_H
@@ -5,93 +5,165 @@
 #include "digit_vector.h"
 
 
-digit_vector::digit_vector(size_t n, digit_t value) :
-        _is_shareable(true), storage(std::make_shared <buffer> (buffer(n, value))) {}
+digit_vector::digit_vector(size_t n, digit_t value) : _head{n, n <= SMALL_SIZE, true, false} {
+    if (!_head.is_small) {
+        _data.storage = buffer::allocate(n);
+    }
+    std::fill(data_ptr(), data_ptr() + n, value);
+}
 
 digit_vector::~digit_vector() {
-    if (storage != nullptr) {
-        storage.reset();
+    if (!_head.is_small) {
+        buffer::release(_data.storage);
     }
 }
 
-digit_vector::digit_vector(digit_vector const& other) : _is_shareable(true) {
-    if (other._is_shareable) {
-        storage = other.storage;
+digit_vector::digit_vector(digit_vector const& other) : _head{other._head.len, true, true, other._head.tag} {
+    if (other._head.is_small) {
+        _data = other._data;
+    }
+    else if (size() <= SMALL_SIZE) {
+        std::copy(other.data(), other.data() + size(), _data.small);
+    }
+    else if (other._head.is_shareable && other._data.storage->is_shareable()) {
+        _head.is_small = false;
+        _data.storage = other._data.storage;
+        _data.storage->refs.acquire();
     }
     else {
-        storage = std::make_shared <buffer> (buffer(*other.storage));
+        _head.is_small = false;
+        _data.storage = buffer::allocate(size());
+        std::copy(other.data(), other.data() + size(), _data.storage->data());
     }
 }
 
-digit_vector &digit_vector::operator=(digit_vector other) {
+digit_vector::digit_vector(digit_vector&& other) noexcept : _head(other._head), _data(other._data) {
+    other._head = {0, true, true, false};
+}
+
+digit_vector &digit_vector::operator=(digit_vector const& other) {
+    digit_vector tmp(other);
+    swap(tmp, *this);
+    return *this;
+}
+
+digit_vector &digit_vector::operator=(digit_vector&& other) noexcept {
     swap(other, *this);
     return *this;
 }
 
 digit_vector::digit_t& digit_vector::operator[](size_t pos) {
-    try_detach(storage->_len);
-    _is_shareable = false;
-    return (storage->data())[pos];
+    try_detach(size());
+    _head.is_shareable = false;
+    return data_ptr()[pos];
 }
 
 digit_vector::digit_t digit_vector::operator[](size_t pos) const {
-    return (storage->data())[pos];
+    return data()[pos];
+}
+
+digit_vector::digit_t const* digit_vector::data() const {
+    return _head.is_small ? _data.small : _data.storage->data();
+}
+
+digit_vector::digit_t* digit_vector::mutable_data() {
+    try_detach(size());
+    return data_ptr();
 }
 
 size_t digit_vector::size() const {
-    return storage->_len;
+    return _head.len;
 }
 
 void digit_vector::push_back(digit_vector::digit_t value) {
-    try_detach(storage->_len + 1);
-    (storage->data())[size()] = value;
-    storage->_len++;
+    try_detach(size() + 1);
+    data_ptr()[_head.len++] = value;
 }
 
+//shrinking only moves the end, even of a shared buffer
 void digit_vector::resize(size_t n, digit_vector::digit_t value) {
-    try_detach(n);
-    while (storage->_len < n) {
-        (storage->data())[storage->_len++] = value;
+    if (n > size()) {
+        try_detach(n);
+        std::fill(data_ptr() + size(), data_ptr() + n, value);
     }
-    storage->_len = n;
+    _head.len = n;
 }
 
 digit_vector::digit_t& digit_vector::back() {
-    return (*this)[storage->_len - 1];
+    return (*this)[size() - 1];
 }
 
 digit_vector::digit_t digit_vector::back() const {
-    return (*this)[storage->_len - 1];
+    return (*this)[size() - 1];
 }
 
 void digit_vector::pop_back() {
-    try_detach(storage->_len);
-    storage->_len--;
+    _head.len--;
 }
 
 bool digit_vector::empty() const {
     return size() == 0;
 }
 
+bool digit_vector::tag() const {
+    return _head.tag;
+}
+
+void digit_vector::set_tag(bool t) {
+    _head.tag = t;
+}
+
 void swap(digit_vector& a, digit_vector& b) noexcept {
-    std::swap(a._is_shareable, b._is_shareable);
-    std::swap(a.storage, b.storage);
+    std::swap(a._head, b._head);
+    std::swap(a._data, b._data);
 }
 
 bool operator==(digit_vector const &a, digit_vector const &b) {
-    return *a.storage == *b.storage;
+    return a.size() == b.size() && std::equal(a.data(), a.data() + a.size(), b.data());
 }
 
 bool operator!=(digit_vector const &a, digit_vector const &b) {
-    return *a.storage != *b.storage;
+    return !(a == b);
 }
 
+digit_vector::digit_t* digit_vector::data_ptr() {
+    return _head.is_small ? _data.small : _data.storage->data();
+}
+
+//makes the storage unique with room for need digits, growing it by EXPAND_FACTOR when it is full,
+//a shared storage is copied only up to need digits; references from operator[] keep the vector
+//unshareable until they are invalidated by moving to a new storage
 void digit_vector::try_detach(size_t need) {
-    if (storage.use_count() == 1) {
-        storage->reserve(need);
+    size_t capacity;
+    if (_head.is_small) {
+        if (need <= SMALL_SIZE) {
+            return;
+        }
+        capacity = std::max(static_cast <size_t> (SMALL_SIZE * EXPAND_FACTOR), need);
+    }
+    else if (_data.storage->refs.unique()) {
+        if (_data.storage->_capacity >= need) {
+            return;
+        }
+        capacity = std::max(static_cast <size_t> (_data.storage->_capacity * EXPAND_FACTOR), need);
+    }
+    else if (need <= SMALL_SIZE) {
+        buffer* shared = _data.storage;
+        std::copy(shared->data(), shared->data() + size(), _data.small);
+        buffer::release(shared);
+        _head.is_small = true;
+        return;
     }
     else {
-        storage = std::make_shared <buffer> (buffer(*storage, need));
+        capacity = need;
     }
-    _is_shareable = true;
-}
\ No newline at end of file
+    size_t len = std::min(size(), need);
+    buffer* detached = buffer::allocate(capacity);
+    std::copy(data(), data() + len, detached->data());
+    if (!_head.is_small) {
+        buffer::release(_data.storage);
+    }
+    _data.storage = detached;
+    _head.is_small = false;
+    _head.is_shareable = true;
+}
@@ -5,108 +5,125 @@
 #ifndef BIGINT_DIGIT_VECTOR_H
 #define BIGINT_DIGIT_VECTOR_H
 
+#include "digit_allocator.h"
 #include <cstdio>
 #include <cstdlib>
 #include <algorithm>
-#include <memory>
+#include <atomic>
 #include <new>
 
 struct digit_vector {
+#ifdef BIGINT_64BIT_DIGITS
+    typedef unsigned long long digit_t;
+#else
     typedef unsigned int digit_t;
+#endif
     static constexpr float EXPAND_FACTOR = 1.5;
-    static const size_t SMALL_STORAGE_MAX_SIZE = 8;
 
-    struct buffer {
-        explicit buffer(size_t n = 0, digit_t value = 0) : _active(nullptr),  _len(n), _capacity(0), _is_big(false) {
-            reserve(n);
-            for (size_t i = 0; i < n; i++) {
-                _active[i] = value;
-            }
+    //reference counts of the shared buffers: plain ones for single-threaded use,
+    //atomic ones with BIGINT_ATOMIC_REFCOUNT for vectors copied between threads
+    struct plain_refcount {
+        explicit plain_refcount(size_t n) : count(n) {}
+
+        void acquire() {
+            count++;
         }
 
-        ~buffer() {
-            if (_active != nullptr && _is_big) {
-                operator delete(_active);
-            }
+        //true when the last reference is gone
+        bool release() {
+            return --count == 0;
         }
 
-        buffer(buffer const& other, size_t n = 0) : _active(nullptr), _len(other._len), _capacity(0) , _is_big(false) {
-            reserve(std::max(other._len, n));
-            if (other._len) {
-                std::copy(other._active, other._active + other._len, _active);
-            }
+        bool unique() const {
+            return count == 1;
         }
 
-        buffer&operator=(buffer other) {
-            swap(*this, other);
-            return *this;
+        size_t count;
+    };
+
+    struct atomic_refcount {
+        explicit atomic_refcount(size_t n) : count(n) {}
+
+        void acquire() {
+            count.fetch_add(1, std::memory_order_relaxed);
         }
 
-        void reserve(size_t n) {
-            if (n <= SMALL_STORAGE_MAX_SIZE && _capacity <= SMALL_STORAGE_MAX_SIZE) {
-                _active = _data.small;
-                _capacity = SMALL_STORAGE_MAX_SIZE;
-                _is_big = false;
-                return;
-            }
-            if (_capacity < n) {
-                size_t need = std::max(static_cast <size_t> (_capacity * EXPAND_FACTOR), n);
-                auto new_data = static_cast <digit_t*> (operator new(sizeof(digit_t) * need));
-                if (_active != nullptr) {
-                    std::copy(_active, _active + _len, new_data);
-                    if (_is_big) {
-                        operator delete(_active);
-                    }
-                }
-                _data.big = new_data;
-                _active = _data.big;
-                _capacity = need;
-                _is_big = true;
-            }
+        bool release() {
+            return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
         }
 
-        digit_t* data() {
-            return _active;
+        bool unique() const {
+            return count.load(std::memory_order_acquire) == 1;
         }
 
-        friend bool operator==(buffer const& a, buffer const& b) {
-            if (a._len != b._len) {
-                return false;
-            }
-            for (size_t i = 0; i < a._len; i++) {
-                if (a._active[i] != b._active[i]) {
-                    return false;
-                }
+        std::atomic <size_t> count;
+    };
+
+#ifdef BIGINT_ATOMIC_REFCOUNT
+    typedef atomic_refcount refcount_policy;
+#else
+    typedef plain_refcount refcount_policy;
+#endif
+
+    //the header of a single allocation from the current digit_allocator, the digits follow it;
+    //the length is kept by each vector, so vectors sharing a buffer may use different prefixes of it
+    struct buffer {
+        buffer(size_t capacity, digit_allocator* alloc) : refs(1), _capacity(capacity), _alloc(alloc) {}
+
+        static buffer* allocate(size_t capacity) {
+            digit_allocator* alloc = digit_allocator::current();
+            return new (alloc->allocate(bytes(capacity))) buffer(capacity, alloc);
+        }
+
+        static void release(buffer* b) {
+            if (b->refs.release()) {
+                digit_allocator* alloc = b->_alloc;
+                size_t size = bytes(b->_capacity);
+                b->~buffer();
+                alloc->deallocate(b, size);
             }
-            return true;
         }
 
-        friend bool operator!=(buffer const& a, buffer const& b) {
-            return !(a == b);
+        static size_t bytes(size_t capacity) {
+            return sizeof(buffer) + sizeof(digit_t) * capacity;
+        }
+
+        digit_t* data() {
+            return reinterpret_cast <digit_t*> (this + 1);
         }
 
-        friend void swap(buffer& a, buffer& b) noexcept {
-            std::swap(a._len, b._len);
-            std::swap(a._capacity, b._capacity);
-            std::swap(a._data, b._data);
+        //copies share only buffers that live as long as they are referenced
+        bool is_shareable() const {
+            return !_alloc->is_scoped();
         }
 
-        union {
-            digit_t small[SMALL_STORAGE_MAX_SIZE];
-            digit_t* big;
-        } _data;
-        digit_t* _active;
-        size_t _len;
+        refcount_policy refs;
         size_t _capacity;
-        bool _is_big;
+        digit_allocator* _alloc;
     };
+    static_assert(sizeof(buffer) % alignof(digit_t) == 0, "digits must be aligned after the header");
+
+    //up to SMALL_SIZE digits live inside the vector in place of the buffer pointer, 24 bytes by default,
+    //enough for a 128-bit value and a carry digit; BIGINT_SMALL_DIGITS sets another count
+#ifdef BIGINT_SMALL_DIGITS
+    static const size_t SMALL_SIZE = BIGINT_SMALL_DIGITS;
+#else
+    static const size_t SMALL_SIZE = 24 / sizeof(digit_t);
+#endif
+    static_assert(SMALL_SIZE * sizeof(digit_t) >= sizeof(buffer*), "the small digits share their place with the pointer");
 
     explicit digit_vector(size_t n = 0, digit_t value = 0);
     ~digit_vector();
     digit_vector(digit_vector const& other);
-    digit_vector&operator=(digit_vector other);
+    digit_vector(digit_vector&& other) noexcept;
+    digit_vector&operator=(digit_vector const& other);
+    digit_vector&operator=(digit_vector&& other) noexcept;
     digit_t&operator[](size_t pos);
     digit_t operator[](size_t pos) const;
+    digit_t const* data() const;
+    //detaches once, unlike operator[] leaves the vector shareable: the pointer is for writing
+    //the digits until the vector is next copied or resized
+    digit_t* mutable_data();
     size_t size() const;
     void push_back(digit_t value);
     void resize(size_t n, digit_t value = 0);
@@ -114,6 +131,9 @@ struct digit_vector {
     digit_t back() const;
     void pop_back();
     bool empty() const;
+    //a bit kept for the owner of the vector, big_integer keeps its sign there
+    bool tag() const;
+    void set_tag(bool t);
 
     friend void swap(digit_vector& a, digit_vector& b) noexcept;
     friend bool operator==(digit_vector const& a, digit_vector const& b);
@@ -121,9 +141,21 @@ struct digit_vector {
 
 private:
     void try_detach(size_t need);
+    digit_t* data_ptr();
+
+    //the length and the flags share one word
+    struct header {
+        size_t len : sizeof(size_t) * 8 - 3;
+        size_t is_small : 1;
+        size_t is_shareable : 1;
+        size_t tag : 1;
+    };
 
-    bool _is_shareable;
-    std::shared_ptr <buffer> storage;
+    header _head;
+    union {
+        buffer* storage;
+        digit_t small[SMALL_SIZE];
+    } _data;
 };
 
 
@@ -3,17 +3,28 @@
 //
 
 #include "big_integer.h"
-
-const unsigned int DIGIT_MAX = UINT32_MAX;
-const int BASE = 32;
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#ifdef BIGINT_ASM_KERNELS
+#ifndef BIGINT_64BIT_DIGITS
+#error "BIGINT_ASM_KERNELS needs BIGINT_64BIT_DIGITS"
+#endif
+//digit loops from helloasm/limbs.asm
+#include "limbs.h"
+#endif
+
+typedef big_integer::digit_t digit_t;
+typedef big_integer::double_digit_t double_digit_t;
+typedef big_integer::digit_storage digit_storage;
+
+const digit_t DIGIT_MAX = std::numeric_limits <digit_t>::max();
+const int BASE = std::numeric_limits <digit_t>::digits;
 const int DEC_BASE = 1e9;
 
-using std::vector;
 using std::string;
 
-typedef unsigned int digit_t;
-typedef unsigned long long double_digit_t;
-
 //cast
 digit_t digit_cast(int x) {
     return (digit_t) (x & DIGIT_MAX);
@@ -65,17 +76,17 @@ string to_string(big_integer const& b) {
     return str;
 }
 
-void div_long_short(vector<digit_t> const &a, const digit_t b, vector<digit_t> &res) {
+void div_long_short(digit_storage const &a, const digit_t b, digit_storage &res) {
     double_digit_t c, carry = 0;
     res.resize(a.size());
     for (size_t i = a.size(); i-- > 0;) {
-        c = (carry << 32) + a[i];
+        c = (carry << BASE) + a[i];
         res[i] = digit_cast(c / b);
         carry = c % b;
     }
 }
 
-void mod_long_short(vector <digit_t> const& a, const digit_t b, vector <digit_t>& res) {
+void mod_long_short(digit_storage const& a, const digit_t b, digit_storage& res) {
     res.resize(1);
     double_digit_t carry = 0;
     for (size_t i = a.size(); i-- > 0;) {
@@ -154,7 +165,7 @@ big_integer::big_integer(const int x)
     trim();
 }
 
-big_integer::big_integer(bool s, vector <digit_t> const& d)
+big_integer::big_integer(bool s, digit_storage const& d)
         : sign(s),
           digits(d) {
     trim();
@@ -172,23 +183,23 @@ big_integer to_number(string const& str) {
         acc = acc * 10 + (str[i] - '0');
         b *= 10;
         if (acc > ((DIGIT_MAX - 9) / 10) || b > DIGIT_MAX / 10) {
-            new_num *= b;
+            new_num *= big_integer(false, {b});
             if (new_sign) {
-                new_num -= acc;
+                new_num -= big_integer(false, {acc});
             }
             else {
-                new_num += acc;
+                new_num += big_integer(false, {acc});
             }
             b = 1, acc = 0;
         }
     }
     if (acc || b > 1) {
-        new_num *= b;
+        new_num *= big_integer(false, {b});
         if (new_sign) {
-            new_num -= acc;
+            new_num -= big_integer(false, {acc});
         }
         else {
-            new_num += acc;
+            new_num += big_integer(false, {acc});
         }
     }
     return new_num;
@@ -247,34 +258,49 @@ bool operator>=(big_integer const &a, big_integer const &b) {
 
 big_integer operator+(big_integer const& a, big_integer const& b) {
     size_t n = std::max(a.length(), b.length()) + 1;
-    vector <digit_t> res(n);
+    digit_storage res(n);
     double_digit_t carry = 0;
     double_digit_t c;
-    for (size_t i = 0; i < n; i++) {
+    size_t i = 0;
+#ifdef BIGINT_ASM_KERNELS
+    i = std::min(a.length(), b.length());
+    carry = add_n(res.data(), a.digits.data(), b.digits.data(), i);
+#endif
+    for (; i < n; i++) {
         c = carry + a.get_digit(i) + b.get_digit(i);
         res[i] = digit_cast(c);
         carry = c >> BASE;
     }
-    bool res_sign = (res.back() & (1 << (BASE - 1)));
+    bool res_sign = (res.back() >> (BASE - 1));
     return big_integer(res_sign, res);
 }
 
 big_integer operator-(big_integer const& a, big_integer const& b) {
     size_t n = std::max(a.length(), b.length()) + 1;
-    vector <digit_t> res(n);
+    digit_storage res(n);
     double_digit_t carry = 1;
     double_digit_t c;
-    for (size_t i = 0; i < n; i++) {
+    size_t i = 0;
+#ifdef BIGINT_ASM_KERNELS
+    i = std::min(a.length(), b.length());
+    carry = 1 - sub_n(res.data(), a.digits.data(), b.digits.data(), i);
+#endif
+    for (; i < n; i++) {
         c = carry + a.get_digit(i) + (~b.get_digit(i));
         res[i] = digit_cast(c);
         carry = c >> BASE;
     }
-    bool res_sign = (res.back() & (1 << (BASE - 1)));
+    bool res_sign = (res.back() >> (BASE - 1));
     return big_integer(res_sign, res);
 }
 
-void long_mul(vector <digit_t> const& a, vector <digit_t> const& b, vector <digit_t>& res) {
+void long_mul(digit_storage const& a, digit_storage const& b, digit_storage& res) {
     res.resize(a.size() + b.size() + 1, 0);
+#ifdef BIGINT_ASM_KERNELS
+    for (size_t i = 0; i < a.size(); i++) {
+        res[i + b.size()] += addmul_1(res.data() + i, b.data(), b.size(), a[i]);
+    }
+#else
     double_digit_t carry = 0, c = 0;
     double_digit_t mul;
     for (size_t i = 0; i < a.size(); i++) {
@@ -287,9 +313,10 @@ void long_mul(vector <digit_t> const& a, vector <digit_t> const& b, vector <digi
         }
         res[i + b.size()] += digit_cast(carry);
     }
+#endif
 }
 
-bool smaller(vector <digit_t> const& a, vector <digit_t> const& b, const size_t shift) {
+bool smaller(digit_storage const& a, digit_storage const& b, const size_t shift) {
     for (size_t i = b.size(); i-- > 0;) {
         if (a[i + shift] != b[i]) {
             return (a[i + shift] < b[i]);
@@ -298,7 +325,10 @@ bool smaller(vector <digit_t> const& a, vector <digit_t> const& b, const size_t
     return false;
 }
 
-void vector_dif(vector<digit_t> &a, vector<digit_t> const &b, const size_t shift) {
+void vector_dif(digit_storage &a, digit_storage const &b, const size_t shift) {
+#ifdef BIGINT_ASM_KERNELS
+    sub_n(a.data() + shift, a.data() + shift, b.data(), b.size());
+#else
     double_digit_t carry = 1;
     double_digit_t c;
     for (size_t i = 0; i < b.size(); i++) {
@@ -306,12 +336,16 @@ void vector_dif(vector<digit_t> &a, vector<digit_t> const &b, const size_t shift
         a[i + shift] = digit_cast(c);
         carry = c >> BASE;
     }
+#endif
 }
-void mul_long_short(vector<digit_t> const &a, const digit_t b, vector<digit_t> &res) {
+void mul_long_short(digit_storage const &a, const digit_t b, digit_storage &res) {
+    res.resize(a.size() + 1);
+#ifdef BIGINT_ASM_KERNELS
+    res[a.size()] = mul_1(res.data(), a.data(), a.size(), b);
+#else
     double_digit_t c;
     double_digit_t carry = 0;
     double_digit_t mul;
-    res.resize(a.size() + 1);
     for (size_t i = 0; i < a.size(); i++) {
         mul = double_digit_cast(a[i]) * b;
         c = mul + carry;
@@ -319,17 +353,18 @@ void mul_long_short(vector<digit_t> const &a, const digit_t b, vector<digit_t> &
         carry = (c >> BASE);
     }
     res[a.size()] = digit_cast(carry);
+#endif
 }
 
 digit_t trial(const digit_t a, const digit_t b, const digit_t div) {
-    return digit_cast(std::min(double_digit_cast(1) + DIGIT_MAX, (((double_digit_t(a)) << BASE) + b) / div));
+    return digit_cast(std::min(double_digit_cast(DIGIT_MAX), (((double_digit_t(a)) << BASE) + b) / div));
 }
 
-void long_div(vector <digit_t> const& a, vector <digit_t> const& b, vector <digit_t>& res) {
+void long_div(digit_storage const& a, digit_storage const& b, digit_storage& res) {
     digit_t scale_factor = digit_cast((double_digit_cast(1) + DIGIT_MAX) / (double_digit_cast(1) + b.back()));
-    vector<digit_t> q;
-    vector<digit_t> d;
-    vector<digit_t> dt;
+    digit_storage q;
+    digit_storage d;
+    digit_storage dt;
     mul_long_short(a, scale_factor, q);
     mul_long_short(b, scale_factor, d);
     while (!d.empty() && d.back() == 0) {
@@ -361,7 +396,7 @@ big_integer operator*(big_integer const& a, big_integer const& b) {
     }
     big_integer x(a.abs());
     big_integer y(b.abs());
-    vector <digit_t> res;
+    digit_storage res;
     if (x.length() < y.length()) {
         swap(x, y);
     }
@@ -388,7 +423,7 @@ big_integer operator/(big_integer const& a, big_integer const& b) {
         return 0;
     }
 
-    vector <digit_t> res;
+    digit_storage res;
     if (y.length() == 1) {
         div_long_short(x.digits, y.get_digit(0), res);
     }
@@ -440,7 +475,7 @@ big_integer big_integer::operator-() const {
     size_t n = digits.size() + 1;
     double_digit_t carry = 1;
     double_digit_t c;
-    vector <digit_t> res(n);
+    digit_storage res(n);
     for (size_t i = 0; i < n; i++) {
         c = carry + (~get_digit(i));
         res[i] = digit_cast(c);
@@ -450,7 +485,7 @@ big_integer big_integer::operator-() const {
 }
 
 big_integer big_integer::operator~() const {
-    vector <digit_t> res;
+    digit_storage res;
     for (size_t i = 0; i < digits.size(); i++) {
         res.push_back(~digits[i]);
     }
@@ -480,7 +515,7 @@ big_integer big_integer::operator--(int) {
 //bitwise
 
 big_integer operator&(big_integer const& a, big_integer const& b) {
-    vector <digit_t> res(std::max(a.length(), b.length()));
+    digit_storage res(std::max(a.length(), b.length()));
     for (size_t i = 0; i < res.size(); i++) {
         res[i] = a.get_digit(i) & b.get_digit(i);
     }
@@ -488,7 +523,7 @@ big_integer operator&(big_integer const& a, big_integer const& b) {
 }
 
 big_integer operator|(big_integer const& a, big_integer const& b) {
-    vector <digit_t> res(std::max(a.length(), b.length()));
+    digit_storage res(std::max(a.length(), b.length()));
     for (size_t i = 0; i < res.size(); i++) {
         res[i] = a.get_digit(i) | b.get_digit(i);
     }
@@ -496,15 +531,15 @@ big_integer operator|(big_integer const& a, big_integer const& b) {
 }
 
 big_integer operator^(big_integer const& a, big_integer const& b) {
-    vector <digit_t> res(std::max(a.length(), b.length()));
+    digit_storage res(std::max(a.length(), b.length()));
     for (size_t i = 0; i < res.size(); i++) {
         res[i] = a.get_digit(i) ^ b.get_digit(i);
     }
     return big_integer(a.sign ^ b.sign, res);
 }
 
-big_integer operator>>(big_integer const& a, digit_t shift) {
-    vector <digit_t> res;
+big_integer operator>>(big_integer const& a, unsigned int shift) {
+    digit_storage res;
     size_t mod = shift % BASE;
     digit_t c;
     for (size_t i = shift / BASE; i < a.length(); i++) {
@@ -514,8 +549,8 @@ big_integer operator>>(big_integer const& a, digit_t shift) {
     return big_integer(a.sign, res);
 }
 
-big_integer operator<<(big_integer const& a, digit_t shift) {
-    vector <digit_t> res(shift / BASE, 0);
+big_integer operator<<(big_integer const& a, unsigned int shift) {
+    digit_storage res(shift / BASE, 0);
     size_t mod = shift % BASE;
     digit_t c;
     for (size_t i = 0; i < a.length(); i++) {
@@ -537,11 +572,11 @@ big_integer& big_integer::operator^=(big_integer const& b) {
     return *this = *this ^ b;
 }
 
-big_integer& big_integer::operator>>=(digit_t shift) {
+big_integer& big_integer::operator>>=(unsigned int shift) {
     return *this = *this >> shift;
 }
 
-big_integer& big_integer::operator<<=(digit_t shift) {
+big_integer& big_integer::operator<<=(unsigned int shift) {
     return *this = *this << shift;
 }
 
@@ -5,16 +5,25 @@
 #ifndef BIGINT_BIG_INTEGER_H
 #define BIGINT_BIG_INTEGER_H
 
+#include "digit_allocator.h"
 #include <string>
 #include <vector>
 
 struct big_integer {
+    //BIGINT_64BIT_DIGITS selects 64-bit digits with 128-bit intermediate products instead of 32-bit ones
+#ifdef BIGINT_64BIT_DIGITS
+    typedef unsigned long long digit_t;
+    __extension__ typedef unsigned __int128 double_digit_t;
+#else
     typedef unsigned int digit_t;
     typedef unsigned long long double_digit_t;
+#endif
+    //digits come from the current digit_allocator
+    typedef std::vector <digit_t, allocator_adaptor <digit_t>> digit_storage;
 
     big_integer();
     big_integer(big_integer const& other);
-    big_integer(bool s, std::vector <digit_t> const& d);
+    big_integer(bool s, digit_storage const& d);
     big_integer(int x);
     explicit big_integer(std::string const& str);
 
@@ -65,7 +74,7 @@ struct big_integer {
     friend void swap(big_integer& a, big_integer& b) noexcept;
 
     big_integer abs() const;
-    bool is_zero_digit(unsigned int d) const;
+    bool is_zero_digit(digit_t d) const;
     bool is_neg_one() const;
     size_t length() const;
     digit_t get_digit(size_t pos) const;
@@ -73,7 +82,7 @@ struct big_integer {
 
 private:
     bool sign;
-    std::vector <digit_t> digits;
+    digit_storage digits;
 
 
     void trim();
@@ -736,3 +736,26 @@ TEST(correctness, div_randomized)
         EXPECT_LT(residue, divisor);
     }
 }
+
+TEST(correctness, digit_allocators)
+{
+    big_integer a = rand_big(40);
+    big_integer b = -rand_big(20);
+    big_integer expected = a * b + a / b - (a << 1000);
+
+    {
+        digit_allocator::scope pool(pool_allocator::instance());
+        EXPECT_EQ(a * b + a / b - (a << 1000), expected);
+    }
+
+    arena_allocator arena(1 << 10);
+    big_integer in_arena;
+    {
+        digit_allocator::scope use(arena);
+        in_arena = a * b + a / b - (a << 1000);
+    }
+    big_integer kept = in_arena;
+    in_arena = 0;
+    arena.release();
+    EXPECT_EQ(kept, expected);
+}
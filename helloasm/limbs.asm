@@ -0,0 +1,146 @@
+; digit loops for big_integer with 64-bit digits, system v calling convention:
+; arguments in rdi, rsi, rdx, rcx, result in rax, rbx, rbp and r12-r15 are preserved
+; a result may alias its operands as long as it starts at the same address
+
+                section         .text
+
+                global          add_n
+                global          sub_n
+                global          mul_1
+                global          addmul_1
+                global          submul_1
+
+; adds two long numbers of the same length
+;    rdi -- address of result (long number)
+;    rsi -- address of summand #1 (long number)
+;    rdx -- address of summand #2 (long number)
+;    rcx -- length of long numbers in qwords
+; result:
+;    rax -- carry (0 or 1)
+add_n:
+                xor             eax, eax
+                test            rcx, rcx
+                jz              .done
+                xor             r8d, r8d
+.loop:
+                mov             rax, [rsi + 8 * r8]
+                adc             rax, [rdx + 8 * r8]
+                mov             [rdi + 8 * r8], rax
+                inc             r8
+                dec             rcx
+                jnz             .loop
+
+                setc            al
+                movzx           eax, al
+.done:
+                ret
+
+; subtracts two long numbers of the same length
+;    rdi -- address of result (long number)
+;    rsi -- address of minuend (long number)
+;    rdx -- address of subtrahend (long number)
+;    rcx -- length of long numbers in qwords
+; result:
+;    rax -- borrow (0 or 1)
+sub_n:
+                xor             eax, eax
+                test            rcx, rcx
+                jz              .done
+                xor             r8d, r8d
+.loop:
+                mov             rax, [rsi + 8 * r8]
+                sbb             rax, [rdx + 8 * r8]
+                mov             [rdi + 8 * r8], rax
+                inc             r8
+                dec             rcx
+                jnz             .loop
+
+                setc            al
+                movzx           eax, al
+.done:
+                ret
+
+; multiplies long number by a short
+;    rdi -- address of result (long number)
+;    rsi -- address of multiplier #1 (long number)
+;    rdx -- length of long number in qwords
+;    rcx -- multiplier #2 (64-bit unsigned)
+; result:
+;    rax -- the qword carried out of the result
+mul_1:
+                mov             r8, rdx
+                xor             r9d, r9d
+                xor             r10d, r10d
+                test            r8, r8
+                jz              .done
+.loop:
+                mov             rax, [rsi + 8 * r10]
+                mul             rcx
+                add             rax, r9
+                adc             rdx, 0
+                mov             [rdi + 8 * r10], rax
+                mov             r9, rdx
+                inc             r10
+                cmp             r10, r8
+                jb              .loop
+.done:
+                mov             rax, r9
+                ret
+
+; adds product of long number and a short to the result
+;    rdi -- address of result (long number)
+;    rsi -- address of multiplier #1 (long number)
+;    rdx -- length of long numbers in qwords
+;    rcx -- multiplier #2 (64-bit unsigned)
+; result:
+;    rax -- the qword carried out of the result
+addmul_1:
+                mov             r8, rdx
+                xor             r9d, r9d
+                xor             r10d, r10d
+                test            r8, r8
+                jz              .done
+.loop:
+                mov             rax, [rsi + 8 * r10]
+                mul             rcx
+                add             rax, r9
+                adc             rdx, 0
+                add             [rdi + 8 * r10], rax
+                adc             rdx, 0
+                mov             r9, rdx
+                inc             r10
+                cmp             r10, r8
+                jb              .loop
+.done:
+                mov             rax, r9
+                ret
+
+; subtracts product of long number and a short from the result
+;    rdi -- address of result (long number)
+;    rsi -- address of multiplier #1 (long number)
+;    rdx -- length of long numbers in qwords
+;    rcx -- multiplier #2 (64-bit unsigned)
+; result:
+;    rax -- the qword borrowed from above the result
+submul_1:
+                mov             r8, rdx
+                xor             r9d, r9d
+                xor             r10d, r10d
+                test            r8, r8
+                jz              .done
+.loop:
+                mov             rax, [rsi + 8 * r10]
+                mul             rcx
+                add             rax, r9
+                adc             rdx, 0
+                sub             [rdi + 8 * r10], rax
+                adc             rdx, 0
+                mov             r9, rdx
+                inc             r10
+                cmp             r10, r8
+                jb              .loop
+.done:
+                mov             rax, r9
+                ret
+
+                section         .note.GNU-stack noalloc noexec nowrite progbits
@@ -0,0 +1,29 @@
+//
+// Digit loops from limbs.asm, 64-bit digits
+//
+
+#ifndef HELLOASM_LIMBS_H
+#define HELLOASM_LIMBS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//r[0, n) = a[0, n) + b[0, n), returns the carry
+unsigned long long add_n(unsigned long long* r, unsigned long long const* a, unsigned long long const* b, size_t n);
+//r[0, n) = a[0, n) - b[0, n), returns the borrow
+unsigned long long sub_n(unsigned long long* r, unsigned long long const* a, unsigned long long const* b, size_t n);
+//r[0, n) = a[0, n) * d, returns the carry digit
+unsigned long long mul_1(unsigned long long* r, unsigned long long const* a, size_t n, unsigned long long d);
+//r[0, n) += a[0, n) * d, returns the carry digit
+unsigned long long addmul_1(unsigned long long* r, unsigned long long const* a, size_t n, unsigned long long d);
+//r[0, n) -= a[0, n) * d, returns the digit to subtract from r[n]
+unsigned long long submul_1(unsigned long long* r, unsigned long long const* a, size_t n, unsigned long long d);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //HELLOASM_LIMBS_H
@@ -0,0 +1,103 @@
+//
+// Compares the digit loops of limbs.asm with 128-bit C++ references, exits with 1 on a mismatch
+//
+
+#include "limbs.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+typedef unsigned long long digit_t;
+__extension__ typedef unsigned __int128 double_digit_t;
+
+const size_t MAX_LEN = 9;
+
+int mismatches = 0;
+
+void check(bool ok, char const* name, size_t n) {
+    if (!ok) {
+        if (mismatches < 10) {
+            std::printf("%s differs for n = %zu\n", name, n);
+        }
+        mismatches++;
+    }
+}
+
+bool equal(digit_t const* a, digit_t const* b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    std::mt19937_64 gen(1);
+    //all-ones operands make every carry and borrow propagate
+    auto digit = [&](bool ones) {
+        return ones ? ~digit_t(0) : gen();
+    };
+    for (int it = 0; it < 20000; it++) {
+        size_t n = gen() % MAX_LEN;
+        digit_t a[MAX_LEN], b[MAX_LEN], r0[MAX_LEN], r[MAX_LEN], e[MAX_LEN];
+        digit_t d = digit(it % 3 == 0);
+        for (size_t i = 0; i < n; i++) {
+            a[i] = digit(it % 5 == 0);
+            b[i] = digit(it % 7 == 0);
+            r0[i] = gen();
+        }
+
+        double_digit_t c = 0;
+        digit_t carry = add_n(r, a, b, n);
+        for (size_t i = 0; i < n; i++) {
+            c += double_digit_t(a[i]) + b[i];
+            e[i] = digit_t(c);
+            c >>= 64;
+        }
+        check(equal(r, e, n) && carry == digit_t(c), "add_n", n);
+
+        digit_t borrow = 0;
+        carry = sub_n(r, a, b, n);
+        for (size_t i = 0; i < n; i++) {
+            e[i] = a[i] - b[i] - borrow;
+            borrow = (a[i] < b[i] || (a[i] == b[i] && borrow != 0)) ? 1 : 0;
+        }
+        check(equal(r, e, n) && carry == borrow, "sub_n", n);
+
+        c = 0;
+        carry = mul_1(r, a, n, d);
+        for (size_t i = 0; i < n; i++) {
+            c += double_digit_t(a[i]) * d;
+            e[i] = digit_t(c);
+            c >>= 64;
+        }
+        check(equal(r, e, n) && carry == digit_t(c), "mul_1", n);
+
+        c = 0;
+        std::copy(r0, r0 + n, r);
+        carry = addmul_1(r, a, n, d);
+        for (size_t i = 0; i < n; i++) {
+            c += double_digit_t(a[i]) * d + r0[i];
+            e[i] = digit_t(c);
+            c >>= 64;
+        }
+        check(equal(r, e, n) && carry == digit_t(c), "addmul_1", n);
+
+        borrow = 0;
+        std::copy(r0, r0 + n, r);
+        carry = submul_1(r, a, n, d);
+        for (size_t i = 0; i < n; i++) {
+            double_digit_t p = double_digit_t(a[i]) * d + borrow;
+            digit_t low = digit_t(p);
+            borrow = digit_t(p >> 64) + (r0[i] < low ? 1 : 0);
+            e[i] = r0[i] - low;
+        }
+        check(equal(r, e, n) && carry == borrow, "submul_1", n);
+    }
+    if (mismatches != 0) {
+        std::printf("%d mismatches\n", mismatches);
+        return 1;
+    }
+    return 0;
+}